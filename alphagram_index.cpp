@@ -0,0 +1,179 @@
+#include "alphagram_index.h"
+
+#include <QtCore>
+
+#include <algorithm>
+#include <tuple>
+
+AlphagramIndex::AlphagramIndex() : table_mask_(0) {}
+
+AlphagramKey AlphagramIndex::Key(const WordString& word) {
+  PackedRack letters;
+  for (Letter letter : word) {
+    if (letter >= FIRST_LETTER && letter <= LAST_LETTER) {
+      letters.Add(letter);
+    }
+  }
+  return letters.ToValue();
+}
+
+uint32_t AlphagramIndex::Hash(AlphagramKey key) {
+  const uint64_t low = static_cast<uint64_t>(key);
+  const uint64_t high = static_cast<uint64_t>(key >> 64);
+  uint64_t hash = (low ^ (high * 0x9E3779B97F4A7C15ULL)) * 0xFF51AFD7ED558CCDULL;
+  return hash >> 32;
+}
+
+bool AlphagramIndex::Build(const Anagrammer& anagrammer) {
+  alphagrams_.clear();
+  words_.clear();
+  lexicons_.clear();
+  // Files without word counts can't look words up by ID, but walking the
+  // graph lists them in the same order.
+  std::vector<WordString> words_by_id;
+  words_by_id.reserve(anagrammer.NumWords());
+  anagrammer.AllWords(&words_by_id);
+  const int num_words = words_by_id.size();
+  if (num_words == 0) {
+    qInfo() << "can't index alphagrams of an empty lexicon";
+    return false;
+  }
+
+  // Group the words by key.
+  std::vector<std::pair<AlphagramKey, int>> keyed_words;
+  keyed_words.reserve(num_words);
+  for (int id = 0; id < num_words; ++id) {
+    keyed_words.push_back({Key(words_by_id[id]), id});
+  }
+  std::sort(keyed_words.begin(), keyed_words.end());
+
+  struct Group {
+    int length;
+    int num_words;
+    AlphagramKey key;
+    int first;
+  };
+  std::vector<Group> groups;
+  for (size_t i = 0; i < keyed_words.size();) {
+    size_t end = i;
+    while (end < keyed_words.size() &&
+           keyed_words[end].first == keyed_words[i].first) {
+      ++end;
+    }
+    const int length = words_by_id[keyed_words[i].second].length();
+    groups.push_back({length, static_cast<int>(end - i), keyed_words[i].first,
+                      static_cast<int>(i)});
+    i = end;
+  }
+  std::sort(groups.begin(), groups.end(), [](const Group& a, const Group& b) {
+    return std::tie(a.length, a.num_words, a.key) <
+           std::tie(b.length, b.num_words, b.key);
+  });
+
+  length_starts_.assign(WordString::maxSize + 2, 0);
+  alphagrams_.reserve(groups.size());
+  words_.reserve(num_words);
+  lexicons_.reserve(num_words);
+  for (const Group& group : groups) {
+    length_starts_[group.length + 1]++;
+    alphagrams_.push_back({group.key, static_cast<int>(words_.size()),
+                           group.num_words});
+    for (int i = group.first; i < group.first + group.num_words; ++i) {
+      const WordString& word = words_by_id[keyed_words[i].second];
+      words_.push_back(word);
+      lexicons_.push_back(anagrammer.Lexicons(word));
+    }
+  }
+  for (size_t length = 1; length < length_starts_.size(); ++length) {
+    length_starts_[length] += length_starts_[length - 1];
+  }
+
+  // At most half full.
+  uint32_t table_size = 1;
+  while (table_size < 2 * alphagrams_.size()) {
+    table_size <<= 1;
+  }
+  table_.assign(table_size, 0);
+  table_mask_ = table_size - 1;
+  for (size_t i = 0; i < alphagrams_.size(); ++i) {
+    uint32_t slot = Hash(alphagrams_[i].key) & table_mask_;
+    while (table_[slot] != 0) {
+      slot = (slot + 1) & table_mask_;
+    }
+    table_[slot] = i + 1;
+  }
+  qInfo() << "indexed" << words_.size() << "words under" << alphagrams_.size()
+          << "alphagrams";
+  return true;
+}
+
+int AlphagramIndex::Find(AlphagramKey key) const {
+  if (table_.empty()) return -1;
+  for (uint32_t slot = Hash(key) & table_mask_;; slot = (slot + 1) & table_mask_) {
+    const int entry = table_[slot];
+    if (entry == 0) return -1;
+    if (alphagrams_[entry - 1].key == key) return entry - 1;
+  }
+}
+
+void AlphagramIndex::FindWithBlanks(const WordString& rack,
+                                    std::vector<int>* found) const {
+  PackedRack letters(rack);
+  const int blanks = letters.Count(BLANK);
+  for (int i = 0; i < blanks; ++i) {
+    letters.Remove(BLANK);
+  }
+  FindWithBlanks(letters, blanks, FIRST_LETTER, found);
+}
+
+// Blanks are assigned letters in nondecreasing order, so each multiset of
+// blank letters is probed once.
+void AlphagramIndex::FindWithBlanks(PackedRack letters, int blanks,
+                                    Letter min_letter,
+                                    std::vector<int>* found) const {
+  if (blanks == 0) {
+    const int alphagram = Find(letters.ToValue());
+    if (alphagram >= 0) {
+      found->push_back(alphagram);
+    }
+    return;
+  }
+  for (Letter letter = min_letter; letter <= LAST_LETTER; ++letter) {
+    PackedRack with_letter = letters;
+    with_letter.Add(letter);
+    FindWithBlanks(with_letter, blanks - 1, letter, found);
+  }
+}
+
+int AlphagramIndex::LengthBegin(int length) const {
+  if (length_starts_.empty()) return 0;
+  length = std::max(0, std::min<int>(length, length_starts_.size() - 1));
+  return length_starts_[length];
+}
+
+void AlphagramIndex::Sample(const std::vector<int>& lengths,
+                            int min_solutions, int max_solutions, int count,
+                            Random* random,
+                            std::vector<int>* chosen) const {
+  // The matching alphagrams of each length are one contiguous range.
+  std::vector<std::pair<int, int>> ranges;
+  for (int length : lengths) {
+    if (length < 0 || length + 1 >= static_cast<int>(length_starts_.size())) {
+      continue;
+    }
+    const auto begin = alphagrams_.begin() + length_starts_[length];
+    const auto end = alphagrams_.begin() + length_starts_[length + 1];
+    const auto first = std::lower_bound(
+        begin, end, min_solutions, [](const Alphagram& a, int solutions) {
+          return a.num_words < solutions;
+        });
+    const auto last = std::upper_bound(
+        first, end, max_solutions, [](int solutions, const Alphagram& a) {
+          return solutions < a.num_words;
+        });
+    if (first < last) {
+      ranges.push_back({first - alphagrams_.begin(), last - first});
+    }
+  }
+  Util::SampleRanges(ranges, count, random, chosen);
+}
@@ -0,0 +1,77 @@
+#ifndef ALPHAGRAM_INDEX_H
+#define ALPHAGRAM_INDEX_H
+
+#include <vector>
+
+#include "anagrammer.h"
+#include "packed_rack.h"
+#include "random.h"
+#include "util.h"
+
+// The PackedRack of a word's letters, so every anagram of a word has the
+// same key. The blank's count is always zero.
+using AlphagramKey = PackedRack::Value;
+
+// Every word in the lexicon grouped by alphagram. The words sit in one flat
+// array, each alphagram's words contiguous, and the alphagrams are sorted by
+// length and then by number of solutions, so picking quiz questions by
+// length and solution count is a binary search and a sample over a range.
+// An open-addressed hash table maps keys to alphagrams for exact lookups.
+class AlphagramIndex {
+ public:
+  struct Alphagram {
+    AlphagramKey key;
+    // Into the flat word array.
+    int first_word;
+    int num_words;
+  };
+
+  AlphagramIndex();
+
+  // Indexes every word of anagrammer's lexicon.
+  bool Build(const Anagrammer& anagrammer);
+  bool IsEmpty() const { return alphagrams_.empty(); }
+
+  static AlphagramKey Key(const WordString& word);
+
+  // The alphagram with the given letters, or -1 if no word has them.
+  int Find(AlphagramKey key) const;
+  int Find(const WordString& rack) const { return Find(Key(rack)); }
+
+  // The alphagrams of every word that uses all of rack, with each blank
+  // standing for any letter: 26 probes per blank. Words reached through
+  // different blank letters are different alphagrams, so none repeats.
+  void FindWithBlanks(const WordString& rack, std::vector<int>* found) const;
+
+  const Alphagram& At(int alphagram) const { return alphagrams_[alphagram]; }
+  int NumAlphagrams() const { return alphagrams_.size(); }
+  // The alphagrams of length letters are [LengthBegin, LengthEnd).
+  int LengthBegin(int length) const;
+  int LengthEnd(int length) const { return LengthBegin(length + 1); }
+  int NumWords() const { return words_.size(); }
+  // A position in the flat word array, which doubles as a dense word ID.
+  const WordString& Word(int word) const { return words_[word]; }
+  int Lexicons(int word) const { return lexicons_[word]; }
+
+  // Adds up to count distinct alphagrams, chosen uniformly from those with
+  // one of lengths and between min_solutions and max_solutions words.
+  void Sample(const std::vector<int>& lengths, int min_solutions,
+              int max_solutions, int count, Random* random,
+              std::vector<int>* chosen) const;
+
+ private:
+  static uint32_t Hash(AlphagramKey key);
+  void FindWithBlanks(PackedRack letters, int blanks, Letter min_letter,
+                      std::vector<int>* found) const;
+
+  std::vector<Alphagram> alphagrams_;
+  std::vector<WordString> words_;
+  std::vector<int> lexicons_;
+  // alphagrams_ of length n start at length_starts_[n].
+  std::vector<int> length_starts_;
+  // Alphagram index plus one, or zero for an empty slot.
+  std::vector<int> table_;
+  uint32_t table_mask_;
+};
+
+#endif  // ALPHAGRAM_INDEX_H
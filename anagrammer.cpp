@@ -0,0 +1,255 @@
+#include <QtCore>
+
+#include <algorithm>
+
+#include "anagrammer.h"
+#include "compressed_gaddag.h"
+
+Anagrammer* Anagrammer::Create(const GaddagFile& file) {
+  const char* data = file.NodeData();
+  const int flags = file.Flags();
+  const int num_words = file.NumWords();
+  if (file.IsCompressed()) {
+    if (file.IsDawg()) {
+      return new DawgAnagrammer<CompressedGaddag>(data, flags, num_words);
+    }
+    return new GaddagAnagrammer<CompressedGaddag>(data, flags, num_words);
+  }
+  if (file.IsDawg()) {
+    if (file.HasNodeInfo()) {
+      return new DawgAnagrammer<AnnotatedGaddag>(data, flags, num_words);
+    }
+    return new DawgAnagrammer<AlignedGaddag>(data, flags, num_words);
+  }
+  if (file.Version() >= 3) {
+    if (file.HasNodeInfo()) {
+      return new GaddagAnagrammer<AnnotatedGaddag>(data, flags, num_words);
+    }
+    return new GaddagAnagrammer<AlignedGaddag>(data, flags, num_words);
+  }
+  switch (file.IndexSize()) {
+    case 1:
+      return new GaddagAnagrammer<Gaddag<4, 1>>(data, flags, num_words);
+    case 2:
+      return new GaddagAnagrammer<Gaddag<4, 2>>(data, flags, num_words);
+    case 3:
+      return new GaddagAnagrammer<Gaddag<4, 3>>(data, flags, num_words);
+    case 4:
+      return new GaddagAnagrammer<Gaddag<4, 4>>(data, flags, num_words);
+  }
+  qInfo() << "no anagrammer for index size" << file.IndexSize();
+  return nullptr;
+}
+
+std::vector<WordString> Anagrammer::GetAnagrams(const WordString& rack,
+                                                bool must_use_all) const {
+  std::vector<WordString> anagrams;
+  GetAnagrams(rack, must_use_all, &anagrams);
+  return anagrams;
+}
+
+std::map<WordString, int> Anagrammer::GetAnagramsWithLexicons(
+    const WordString& rack, bool must_use_all) const {
+  std::vector<WordString> anagrams;
+  std::vector<int> lexicons;
+  GetAnagrams(rack, must_use_all, &anagrams, &lexicons);
+  std::map<WordString, int> words;
+  for (size_t i = 0; i < anagrams.size(); ++i) {
+    words[anagrams[i]] = lexicons[i];
+  }
+  return words;
+}
+
+std::map<WordString, int> Anagrammer::GetSubanagrams(const WordString& rack,
+                                                     int min_length,
+                                                     int max_length) const {
+  std::vector<WordString> anagrams;
+  std::vector<int> lexicons;
+  GetSubanagrams(rack, min_length, max_length, &anagrams, &lexicons);
+  std::map<WordString, int> words;
+  for (size_t i = 0; i < anagrams.size(); ++i) {
+    words[anagrams[i]] = lexicons[i];
+  }
+  return words;
+}
+
+std::vector<int> Anagrammer::GetAnagramIds(const WordString& rack,
+                                           bool must_use_all) const {
+  std::vector<WordString> anagrams;
+  GetAnagrams(rack, must_use_all, &anagrams);
+  std::vector<int> ids;
+  for (const WordString& word : anagrams) {
+    ids.push_back(WordId(word));
+  }
+  std::sort(ids.begin(), ids.end());
+  return ids;
+}
+
+bool Anagrammer::RandomWord(int length, Random* random,
+                            WordString* word) const {
+  const int num_words = NumWords();
+  if (num_words == 0) return false;
+  // Enough draws to find a length that makes up a thousandth of the lexicon
+  // with overwhelming probability.
+  const int max_draws = 100000;
+  for (int i = 0; i < max_draws; ++i) {
+    *word = Word(random->Uniform(num_words));
+    if (static_cast<int>(word->length()) == length) return true;
+  }
+  return false;
+}
+
+template <typename GaddagType>
+int GaddagAnagrammer<GaddagType>::FindAnagrams(
+    const WordString& rack, bool must_use_all, int min_length, int max_length,
+    int limit, std::vector<WordString>* anagrams,
+    std::vector<int>* lexicons) const {
+  Results results = {anagrams, lexicons, limit, 0};
+  results.Clear();
+  PackedRack tiles(rack);
+  WordString prefix;
+  Anagram(gaddag_.Root(), &tiles, tiles.LetterBits(), rack.length(),
+          min_length, max_length, &prefix, &results, must_use_all);
+  return results.count;
+}
+
+template <typename GaddagType>
+bool GaddagAnagrammer<GaddagType>::Anagram(
+    const unsigned char* node, PackedRack* tiles, uint32_t rack_bits,
+    int num_tiles, int min_length, int max_length, WordString* prefix,
+    Results* results, bool must_use_all) const {
+  if (prefix->length() == 1) {
+    const unsigned char* separator = gaddag_.ChangeDirection(node);
+    if (separator == nullptr) return true;
+    node = gaddag_.FollowIndex(separator);
+    if (node == nullptr) return true;
+  }
+  // Past the separator every remaining tile has to go on a path below node,
+  // so skip subtrees that are missing one of the rack's letters or whose
+  // words are all too short or too long. Blanks only count toward length.
+  // Otherwise skip subtrees with no word inside the length window.
+  if (prefix->length() > 0) {
+    if (must_use_all) {
+      if (!gaddag_.CanPlaceAll(node, rack_bits,
+                               num_tiles - prefix->length())) {
+        return true;
+      }
+    } else if (!gaddag_.CanCompleteLength(node,
+                                          min_length - prefix->length(),
+                                          max_length - prefix->length())) {
+      return true;
+    }
+  }
+  const bool has_blank = tiles->Has(BLANK);
+  if (!has_blank && !gaddag_.HasAnyChild(node, rack_bits)) return true;
+  // A letter is played from a real tile whenever one is left and from a
+  // blank only once they have run out, so each word is reached along exactly
+  // one path.
+  const uint32_t letter_bits = has_blank ? ~0u : rack_bits;
+  Letter min_letter = FIRST_LETTER;
+  // The root has a separator child for patterns that start with one.
+  int child_index = gaddag_.HasChild(node, GADDAG_SEPARATOR) ? 1 : 0;
+  for (;;) {
+    Letter found_letter;
+    const unsigned char* child = gaddag_.NextRackChild(
+        node, min_letter, letter_bits, &child_index, &found_letter);
+    if (child == nullptr) return true;
+    const Letter tile = tiles->Has(found_letter) ? found_letter : BLANK;
+    prefix->push_back(found_letter);
+    tiles->Remove(tile);
+    const uint32_t child_rack_bits =
+        (tile == BLANK || tiles->Has(found_letter))
+            ? rack_bits
+            : rack_bits & ~(1 << found_letter);
+    if (gaddag_.CompletesWord(child) &&
+        static_cast<int>(prefix->length()) >= min_length) {
+      if ((!must_use_all || tiles->IsEmpty()) &&
+          !results->Add(*prefix, gaddag_, node, child)) {
+        return false;
+      }
+    }
+    const unsigned char* new_node = gaddag_.FollowIndex(child);
+    if (new_node != nullptr &&
+        static_cast<int>(prefix->length()) < max_length) {
+      // Past the limit nothing is unwound; FindAnagrams discards the
+      // traversal's state.
+      if (!Anagram(new_node, tiles, child_rack_bits, num_tiles, min_length,
+                   max_length, prefix, results, must_use_all)) {
+        return false;
+      }
+    }
+    prefix->pop_back();
+    tiles->Add(tile);
+    min_letter = found_letter + 1;
+    ++child_index;
+  }
+}
+
+template <typename GaddagType>
+int DawgAnagrammer<GaddagType>::FindAnagrams(
+    const WordString& rack, bool must_use_all, int min_length, int max_length,
+    int limit, std::vector<WordString>* anagrams,
+    std::vector<int>* lexicons) const {
+  Results results = {anagrams, lexicons, limit, 0};
+  results.Clear();
+  PackedRack tiles(rack);
+  WordString prefix;
+  Anagram(dawg_.Root(), &tiles, tiles.LetterBits(), rack.length(),
+          min_length, max_length, &prefix, &results, must_use_all);
+  return results.count;
+}
+
+template <typename GaddagType>
+bool DawgAnagrammer<GaddagType>::Anagram(
+    const unsigned char* node, PackedRack* tiles, uint32_t rack_bits,
+    int num_tiles, int min_length, int max_length, WordString* prefix,
+    Results* results, bool must_use_all) const {
+  if (must_use_all) {
+    if (!dawg_.CanPlaceAll(node, rack_bits, num_tiles - prefix->length())) {
+      return true;
+    }
+  } else if (!dawg_.CanCompleteLength(node, min_length - prefix->length(),
+                                      max_length - prefix->length())) {
+    return true;
+  }
+  const bool has_blank = tiles->Has(BLANK);
+  if (!has_blank && !dawg_.HasAnyChild(node, rack_bits)) return true;
+  // Real tiles before blanks, as in GaddagAnagrammer::Anagram.
+  const uint32_t letter_bits = has_blank ? ~0u : rack_bits;
+  Letter min_letter = FIRST_LETTER;
+  int child_index = 0;
+  for (;;) {
+    Letter found_letter;
+    const unsigned char* child = dawg_.NextRackChild(
+        node, min_letter, letter_bits, &child_index, &found_letter);
+    if (child == nullptr) return true;
+    const Letter tile = tiles->Has(found_letter) ? found_letter : BLANK;
+    prefix->push_back(found_letter);
+    tiles->Remove(tile);
+    const uint32_t child_rack_bits =
+        (tile == BLANK || tiles->Has(found_letter))
+            ? rack_bits
+            : rack_bits & ~(1 << found_letter);
+    if (dawg_.CompletesWord(child) &&
+        static_cast<int>(prefix->length()) >= min_length) {
+      if ((!must_use_all || tiles->IsEmpty()) &&
+          !results->Add(*prefix, dawg_, node, child)) {
+        return false;
+      }
+    }
+    const unsigned char* new_node = dawg_.FollowIndex(child);
+    if (new_node != nullptr &&
+        static_cast<int>(prefix->length()) < max_length) {
+      // Past the limit nothing is unwound; FindAnagrams discards the
+      // traversal's state.
+      if (!Anagram(new_node, tiles, child_rack_bits, num_tiles, min_length,
+                   max_length, prefix, results, must_use_all)) {
+        return false;
+      }
+    }
+    prefix->pop_back();
+    tiles->Add(tile);
+    min_letter = found_letter + 1;
+    ++child_index;
+  }
+}
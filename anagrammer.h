@@ -0,0 +1,211 @@
+#ifndef ANAGRAMMER_H
+#define ANAGRAMMER_H
+
+#include <limits>
+#include <map>
+#include <vector>
+
+#include "gaddag.h"
+#include "gaddag_file.h"
+#include "packed_rack.h"
+#include "random.h"
+#include "util.h"
+#include "word_numbering.h"
+
+// Finds the words that can be made from a rack. The Gaddag layout is a
+// template parameter, so every file layout gets its own compiled traversal
+// and the only runtime dispatch left is one virtual call per query.
+class Anagrammer {
+ public:
+  virtual ~Anagrammer() {}
+
+  // Returns an anagrammer for the layout described by file's header, or
+  // nullptr if there is no instantiation for it.
+  static Anagrammer* Create(const GaddagFile& file);
+
+  // For the limit arguments below: never stop early.
+  static constexpr int kNoLimit = std::numeric_limits<int>::max() - 1;
+
+  // Each word once, in no particular order.
+  std::vector<WordString> GetAnagrams(const WordString& rack,
+                                      bool must_use_all) const;
+
+  // Replaces the contents of anagrams with the same words and, unless
+  // lexicons is null, those of lexicons with their lexicon bitmasks, and
+  // returns how many there are. Once the vectors have grown to fit, calls
+  // allocate nothing, so loops over many racks should reuse one pair.
+  //
+  // Once more than limit words are found the traversal stops, leaving
+  // limit + 1 of them and returning limit + 1.
+  int GetAnagrams(const WordString& rack, bool must_use_all,
+                  std::vector<WordString>* anagrams,
+                  std::vector<int>* lexicons = nullptr,
+                  int limit = kNoLimit) const {
+    return FindAnagrams(rack, must_use_all, 0, rack.length(), limit, anagrams,
+                        lexicons);
+  }
+
+  // The number of words GetAnagrams would find, without storing any, or
+  // limit + 1 as soon as there are more than limit of them.
+  int CountAnagrams(const WordString& rack, bool must_use_all,
+                    int limit = kNoLimit) const {
+    return FindAnagrams(rack, must_use_all, 0, rack.length(), limit, nullptr,
+                        nullptr);
+  }
+
+  // The same words, each with the bitmask of lexicons that contain it.
+  std::map<WordString, int> GetAnagramsWithLexicons(const WordString& rack,
+                                                    bool must_use_all) const;
+
+  // The words of min_length to max_length letters that can be made from some
+  // of rack's tiles, each with its lexicon bitmask. The traversal never goes
+  // deeper than max_length and, with node info, skips subtrees whose words
+  // all fall outside the window.
+  std::map<WordString, int> GetSubanagrams(const WordString& rack,
+                                           int min_length,
+                                           int max_length) const;
+
+  // The same words into reusable vectors, and their count, as for
+  // GetAnagrams and CountAnagrams.
+  int GetSubanagrams(const WordString& rack, int min_length, int max_length,
+                     std::vector<WordString>* anagrams,
+                     std::vector<int>* lexicons = nullptr,
+                     int limit = kNoLimit) const {
+    return FindAnagrams(rack, false, min_length, max_length, limit, anagrams,
+                        lexicons);
+  }
+  int CountSubanagrams(const WordString& rack, int min_length, int max_length,
+                       int limit = kNoLimit) const {
+    return FindAnagrams(rack, false, min_length, max_length, limit, nullptr,
+                        nullptr);
+  }
+
+  // The bitmask of lexicons containing word, zero if none do.
+  virtual int Lexicons(const WordString& word) const = 0;
+
+  // Dense word IDs, for files written with word counts; NumWords() is zero
+  // without them. See WordNumbering.
+  virtual int NumWords() const = 0;
+  virtual int WordId(const WordString& word) const = 0;
+  virtual WordString Word(int id) const = 0;
+  // Every word in ID order, found by traversal, so with or without counts.
+  virtual void AllWords(std::vector<WordString>* words) const = 0;
+
+  // The IDs of GetAnagrams(rack, must_use_all), sorted.
+  std::vector<int> GetAnagramIds(const WordString& rack,
+                                 bool must_use_all) const;
+
+  // Picks a uniformly random word of the given length by drawing IDs until
+  // one has that length. Returns false if none turns up.
+  bool RandomWord(int length, Random* random, WordString* word) const;
+
+ protected:
+  // Where a traversal puts its words.
+  struct Results {
+    // Null to only count.
+    std::vector<WordString>* anagrams;
+    std::vector<int>* lexicons;
+    int limit;
+    int count;
+
+    void Clear() {
+      if (anagrams != nullptr) anagrams->clear();
+      if (lexicons != nullptr) lexicons->clear();
+    }
+
+    // Records word, which ends at the edge child of node. Returns false once
+    // there are more than limit words.
+    template <typename GaddagType>
+    bool Add(const WordString& word, const GaddagType& gaddag,
+             const unsigned char* node, const unsigned char* child) {
+      ++count;
+      if (anagrams != nullptr) {
+        anagrams->push_back(word);
+        if (lexicons != nullptr) {
+          lexicons->push_back(gaddag.Lexicons(node, child));
+        }
+      }
+      return count <= limit;
+    }
+  };
+
+  // The one traversal behind the queries above: replaces the contents of
+  // anagrams, unless it is null, with the words of min_length to max_length
+  // letters, and unless lexicons is null those of lexicons with their
+  // bitmasks. Returns the number of words, stopping at limit + 1.
+  virtual int FindAnagrams(const WordString& rack, bool must_use_all,
+                           int min_length, int max_length, int limit,
+                           std::vector<WordString>* anagrams,
+                           std::vector<int>* lexicons) const = 0;
+};
+
+template <typename GaddagType>
+class GaddagAnagrammer : public Anagrammer {
+ public:
+  GaddagAnagrammer(const char* data, int flags, int num_words)
+      : gaddag_(data, flags), numbering_(data, flags, num_words) {}
+
+  int Lexicons(const WordString& word) const override {
+    return numbering_.Lexicons(word);
+  }
+
+  int NumWords() const override { return numbering_.NumWords(); }
+  int WordId(const WordString& word) const override {
+    return numbering_.WordId(word);
+  }
+  WordString Word(int id) const override { return numbering_.Word(id); }
+  void AllWords(std::vector<WordString>* words) const override {
+    numbering_.Words(words);
+  }
+
+ private:
+  int FindAnagrams(const WordString& rack, bool must_use_all, int min_length,
+                   int max_length, int limit,
+                   std::vector<WordString>* anagrams,
+                   std::vector<int>* lexicons) const override;
+  // Returns false once results is past its limit.
+  bool Anagram(const unsigned char* node, PackedRack* tiles, uint32_t rack_bits,
+               int num_tiles, int min_length, int max_length,
+               WordString* prefix, Results* results, bool must_use_all) const;
+
+  const GaddagType gaddag_;
+  const WordNumbering<GaddagType> numbering_;
+};
+
+// Anagrams against a DAWG file. Every word is spelled forward from the root,
+// so there is no direction change, and with node info every node can be
+// pruned, the root included.
+template <typename GaddagType>
+class DawgAnagrammer : public Anagrammer {
+ public:
+  DawgAnagrammer(const char* data, int flags, int num_words)
+      : dawg_(data, flags), numbering_(data, flags, num_words) {}
+
+  int Lexicons(const WordString& word) const override {
+    return numbering_.Lexicons(word);
+  }
+
+  int NumWords() const override { return numbering_.NumWords(); }
+  int WordId(const WordString& word) const override {
+    return numbering_.WordId(word);
+  }
+  WordString Word(int id) const override { return numbering_.Word(id); }
+  void AllWords(std::vector<WordString>* words) const override {
+    numbering_.Words(words);
+  }
+
+ private:
+  int FindAnagrams(const WordString& rack, bool must_use_all, int min_length,
+                   int max_length, int limit,
+                   std::vector<WordString>* anagrams,
+                   std::vector<int>* lexicons) const override;
+  // Returns false once results is past its limit.
+  bool Anagram(const unsigned char* node, PackedRack* tiles, uint32_t rack_bits,
+               int num_tiles, int min_length, int max_length,
+               WordString* prefix, Results* results, bool must_use_all) const;
+
+  const GaddagType dawg_;
+  const WordNumbering<GaddagType> numbering_;
+};
+
+#endif  // ANAGRAMMER_H
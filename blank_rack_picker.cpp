@@ -0,0 +1,122 @@
+#include "blank_rack_picker.h"
+
+#include <QtConcurrent>
+#include <QtCore>
+
+#include <algorithm>
+#include <limits>
+
+#include "random.h"
+
+namespace {
+
+// Candidate racks sampled per row. Every one already has an acceptable
+// number of solutions; some are still passed over for repeating an answer
+// or overflowing the column.
+constexpr int kCandidatesPerRow = 4;
+
+constexpr int kUnclaimed = std::numeric_limits<int>::max();
+
+struct Column {
+  Column(int number, uint64_t seed) : number(number), random(seed) {}
+
+  int number;
+  Random random;
+  // Into the table.
+  std::vector<int> candidates;
+  // The words of each candidate, found the first time it is considered.
+  std::vector<std::vector<int>> words;
+  std::vector<bool> found;
+  // Into candidates.
+  std::vector<int> picks;
+};
+
+}  // namespace
+
+BlankRackPicker::BlankRackPicker(const AlphagramIndex& index,
+                                 const BlankRackTable& racks)
+    : index_(index), racks_(racks) {}
+
+std::vector<std::vector<BlankRackPicker::Question>> BlankRackPicker::Pick(
+    const std::vector<int>& lengths, int min_solutions, int max_solutions,
+    int num_rows, int num_cols, uint64_t seed) const {
+  Random seeds(seed);
+  std::vector<Column> columns;
+  columns.reserve(num_cols);
+  for (int col = 0; col < num_cols; ++col) {
+    columns.emplace_back(col, seeds.Next());
+  }
+  QtConcurrent::blockingMap(columns, [&](Column& column) {
+    racks_.Sample(lengths, min_solutions, max_solutions,
+                  kCandidatesPerRow * num_rows, &column.random,
+                  &column.candidates);
+    column.words.resize(column.candidates.size());
+    column.found.resize(column.candidates.size());
+  });
+
+  // The column whose picks use each word, by position in the index.
+  std::vector<int> owners(index_.NumWords(), kUnclaimed);
+
+  const auto pick = [&](Column& column) {
+    std::vector<int> picks;
+    std::vector<int> taken;
+    std::vector<int> alphagrams;
+    int row = 0;
+    for (size_t i = 0; i < column.candidates.size() && row < num_rows; ++i) {
+      const int num_solutions = racks_.At(column.candidates[i]).num_solutions;
+      if (row + num_solutions > num_rows) continue;
+      std::vector<int>& words = column.words[i];
+      if (!column.found[i]) {
+        column.found[i] = true;
+        alphagrams.clear();
+        index_.FindWithBlanks(racks_.Tiles(column.candidates[i]), &alphagrams);
+        for (int alphagram : alphagrams) {
+          const AlphagramIndex::Alphagram& entry = index_.At(alphagram);
+          for (int word = entry.first_word;
+               word < entry.first_word + entry.num_words; ++word) {
+            words.push_back(word);
+          }
+        }
+        std::sort(words.begin(), words.end(), [this](int a, int b) {
+          return index_.Word(a) < index_.Word(b);
+        });
+      }
+      const bool blocked =
+          std::any_of(words.begin(), words.end(), [&](int word) {
+            return owners[word] < column.number ||
+                   std::find(taken.begin(), taken.end(), word) != taken.end();
+          });
+      if (blocked) continue;
+      picks.push_back(i);
+      taken.insert(taken.end(), words.begin(), words.end());
+      row += num_solutions;
+    }
+    column.picks.swap(picks);
+  };
+  // Nothing is claimed yet, so this finds the words of nearly every
+  // candidate the settling pass will consider.
+  QtConcurrent::blockingMap(columns, pick);
+  // Settled in column order, each column against the columns before it.
+  for (Column& column : columns) {
+    if (column.number > 0) pick(column);
+    for (int i : column.picks) {
+      for (int word : column.words[i]) owners[word] = column.number;
+    }
+  }
+
+  std::vector<std::vector<Question>> grid(num_cols);
+  for (Column& column : columns) {
+    std::vector<Question>& questions = grid[column.number];
+    int row = 0;
+    for (int i : column.picks) {
+      questions.push_back({column.candidates[i], column.words[i]});
+      row += column.words[i].size();
+    }
+    if (row < num_rows) {
+      qInfo() << "filled" << row << "of" << num_rows << "rows in column"
+              << column.number;
+    }
+    column.random.Shuffle(questions.begin(), questions.end());
+  }
+  return grid;
+}
@@ -0,0 +1,46 @@
+#ifndef BLANK_RACK_PICKER_H
+#define BLANK_RACK_PICKER_H
+
+#include <cstdint>
+#include <vector>
+
+#include "alphagram_index.h"
+#include "blank_rack_table.h"
+
+// Fills a grid of blank-rack questions, one column per task on Qt's global
+// thread pool, so that large grids take about as long as a column per core.
+//
+// Each column samples its own candidate racks with a generator seeded from
+// the quiz seed and its position, and packs its rows greedily, finding the
+// words of its candidates in parallel. Columns may not repeat each other's
+// answers, so they are then settled in column order: each re-picks, avoiding
+// the words of earlier columns' picks, and claims its own. That pass mostly
+// reuses words already found and is one pick per column, and nothing in it
+// depends on which thread ran first, so the grid is a function of the seed
+// alone.
+class BlankRackPicker {
+ public:
+  struct Question {
+    // Into the table.
+    int rack;
+    // Positions in the alphagram index, alphabetical.
+    std::vector<int> words;
+  };
+
+  BlankRackPicker(const AlphagramIndex& index, const BlankRackTable& racks);
+
+  // num_cols columns of questions, each with between min_solutions and
+  // max_solutions answers and at most num_rows answers in all, in random
+  // order within each column. Columns come up short only if their
+  // candidates run out.
+  std::vector<std::vector<Question>> Pick(const std::vector<int>& lengths,
+                                          int min_solutions, int max_solutions,
+                                          int num_rows, int num_cols,
+                                          uint64_t seed) const;
+
+ private:
+  const AlphagramIndex& index_;
+  const BlankRackTable& racks_;
+};
+
+#endif  // BLANK_RACK_PICKER_H
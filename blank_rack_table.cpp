@@ -0,0 +1,194 @@
+#include "blank_rack_table.h"
+
+#include <QFile>
+#include <QtCore>
+
+#include <algorithm>
+#include <tuple>
+
+#include "gaddag_file.h"
+
+namespace {
+
+int Length(const BlankRackTable::Rack& rack) {
+  return rack.letters.NumTiles() + 1;
+}
+
+}  // namespace
+
+BlankRackTable::BlankRackTable() {}
+
+QString BlankRackTable::PathFor(const QString& gaddag_path) {
+  QString path = gaddag_path;
+  if (path.endsWith(".gaddag")) {
+    path.chop(QString(".gaddag").length());
+  }
+  return path + ".blanks";
+}
+
+void BlankRackTable::Build(const AlphagramIndex& index, const Bag& bag,
+                           const QByteArray& hash) {
+  hash_ = hash;
+  racks_.clear();
+  PackedRack drawable(bag);
+  while (drawable.Has(BLANK)) {
+    drawable.Remove(BLANK);
+  }
+
+  // Taking one tile out of each word's alphagram gives the letters of every
+  // rack the word solves with the blank standing for that tile. Each
+  // alphagram yields each of its racks once, one per distinct letter, so
+  // summing its words over the racks counts every solution once.
+  std::vector<std::pair<PackedRack::Value, int>> solved;
+  for (int alphagram = 0; alphagram < index.NumAlphagrams(); ++alphagram) {
+    const AlphagramIndex::Alphagram& entry = index.At(alphagram);
+    const PackedRack letters = PackedRack::FromValue(entry.key);
+    const int length = letters.NumTiles();
+    if (length < kMinLength || length > kMaxLength) continue;
+    for (Letter letter = FIRST_LETTER; letter <= LAST_LETTER; ++letter) {
+      if (!letters.Has(letter)) continue;
+      PackedRack rack = letters;
+      rack.Remove(letter);
+      if (drawable.Contains(rack)) {
+        solved.push_back({rack.ToValue(), entry.num_words});
+      }
+    }
+  }
+  std::sort(solved.begin(), solved.end());
+  for (size_t i = 0; i < solved.size();) {
+    Rack rack = {PackedRack::FromValue(solved[i].first), 0};
+    for (; i < solved.size() && solved[i].first == rack.letters.ToValue();
+         ++i) {
+      rack.num_solutions += solved[i].second;
+    }
+    racks_.push_back(rack);
+  }
+  Index();
+  qInfo() << "found" << racks_.size() << "blank racks of" << kMinLength << "to"
+          << kMaxLength << "tiles";
+}
+
+void BlankRackTable::Index() {
+  std::sort(racks_.begin(), racks_.end(), [](const Rack& a, const Rack& b) {
+    return std::make_tuple(Length(a), a.num_solutions, a.letters.ToValue()) <
+           std::make_tuple(Length(b), b.num_solutions, b.letters.ToValue());
+  });
+  length_starts_.assign(WordString::maxSize + 2, 0);
+  for (const Rack& rack : racks_) {
+    length_starts_[Length(rack) + 1]++;
+  }
+  for (size_t length = 1; length < length_starts_.size(); ++length) {
+    length_starts_[length] += length_starts_[length - 1];
+  }
+}
+
+bool BlankRackTable::Write(const QString& path) const {
+  QByteArray data(kBlankRackTableHeaderSize +
+                      racks_.size() * kBlankRackTableEntrySize,
+                  0);
+  char* out = data.data();
+  out[0] = kBlankRackTableVersion;
+  memcpy(out + kBlankRackTableHashOffset, hash_.constData(),
+         std::min<int>(hash_.size(), kGaddagHashSize));
+  out[kBlankRackTableLengthsOffset] = kMinLength;
+  out[kBlankRackTableLengthsOffset + 1] = kMaxLength;
+  Util::PutLittleEndian(racks_.size(), 4, out + kBlankRackTableCountOffset);
+  out += kBlankRackTableHeaderSize;
+  for (const Rack& rack : racks_) {
+    const PackedRack::Value letters = rack.letters.ToValue();
+    Util::PutLittleEndian(static_cast<uint64_t>(letters), 8, out);
+    Util::PutLittleEndian(static_cast<uint64_t>(letters >> 64), 8, out + 8);
+    Util::PutLittleEndian(rack.num_solutions, 4, out + 16);
+    out += kBlankRackTableEntrySize;
+  }
+
+  QFile output(path);
+  if (!output.open(QIODevice::WriteOnly) ||
+      output.write(data) != data.size()) {
+    qInfo() << "could not write blank racks to" << path;
+    return false;
+  }
+  qInfo() << "wrote" << racks_.size() << "blank racks to" << path;
+  return true;
+}
+
+bool BlankRackTable::Read(const QString& path,
+                          const QByteArray& expected_hash) {
+  racks_.clear();
+  length_starts_.clear();
+  QFile input(path);
+  if (!input.open(QIODevice::ReadOnly)) {
+    return false;
+  }
+  const QByteArray data = input.readAll();
+  const char* in = data.constData();
+  if (data.size() < kBlankRackTableHeaderSize ||
+      in[0] != kBlankRackTableVersion ||
+      in[kBlankRackTableLengthsOffset] != kMinLength ||
+      in[kBlankRackTableLengthsOffset + 1] != kMaxLength) {
+    qInfo() << path << "is not a version" << kBlankRackTableVersion
+            << "blank rack table";
+    return false;
+  }
+  const QByteArray hash(in + kBlankRackTableHashOffset, kGaddagHashSize);
+  if (hash != expected_hash) {
+    qInfo() << path << "was built for lexicon hash" << hash.toHex();
+    return false;
+  }
+  const qint64 num_racks =
+      Util::GetLittleEndian(in + kBlankRackTableCountOffset, 4);
+  if (data.size() !=
+      kBlankRackTableHeaderSize + num_racks * kBlankRackTableEntrySize) {
+    qInfo() << path << "is truncated";
+    return false;
+  }
+  hash_ = hash;
+  racks_.reserve(num_racks);
+  in += kBlankRackTableHeaderSize;
+  for (qint64 i = 0; i < num_racks; ++i) {
+    const PackedRack::Value high = Util::GetLittleEndian(in + 8, 8);
+    const PackedRack::Value letters =
+        (high << 64) | Util::GetLittleEndian(in, 8);
+    racks_.push_back({PackedRack::FromValue(letters),
+                      static_cast<int>(Util::GetLittleEndian(in + 16, 4))});
+    in += kBlankRackTableEntrySize;
+  }
+  // Written sorted, but sorting again costs little and keeps a damaged file
+  // from breaking Sample's binary searches.
+  Index();
+  qInfo() << "read" << racks_.size() << "blank racks from" << path;
+  return true;
+}
+
+WordString BlankRackTable::Tiles(int rack) const {
+  PackedRack tiles = racks_[rack].letters;
+  tiles.Add(BLANK);
+  return tiles.ToWord();
+}
+
+void BlankRackTable::Sample(const std::vector<int>& lengths, int min_solutions,
+                            int max_solutions, int count, Random* random,
+                            std::vector<int>* chosen) const {
+  // As in AlphagramIndex::Sample, the matching racks of each length are one
+  // contiguous range.
+  std::vector<std::pair<int, int>> ranges;
+  for (int length : lengths) {
+    if (length < 0 || length + 1 >= static_cast<int>(length_starts_.size())) {
+      continue;
+    }
+    const auto begin = racks_.begin() + length_starts_[length];
+    const auto end = racks_.begin() + length_starts_[length + 1];
+    const auto first = std::lower_bound(
+        begin, end, min_solutions, [](const Rack& rack, int solutions) {
+          return rack.num_solutions < solutions;
+        });
+    const auto last = std::upper_bound(
+        first, end, max_solutions, [](int solutions, const Rack& rack) {
+          return solutions < rack.num_solutions;
+        });
+    if (first < last) {
+      ranges.push_back({first - racks_.begin(), last - first});
+    }
+  }
+  Util::SampleRanges(ranges, count, random, chosen);
+}
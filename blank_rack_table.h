@@ -0,0 +1,84 @@
+#ifndef BLANK_RACK_TABLE_H
+#define BLANK_RACK_TABLE_H
+
+#include <QByteArray>
+#include <QString>
+
+#include <vector>
+
+#include "alphagram_index.h"
+#include "packed_rack.h"
+#include "random.h"
+#include "util.h"
+
+constexpr int kBlankRackTableVersion = 1;
+constexpr int kBlankRackTableHeaderSize = 32;
+constexpr int kBlankRackTableHashOffset = 1;
+constexpr int kBlankRackTableLengthsOffset = 17;
+constexpr int kBlankRackTableCountOffset = 24;
+// Letters, then number of solutions.
+constexpr int kBlankRackTableEntrySize = 16 + 4;
+
+// Every one-blank rack of kMinLength to kMaxLength tiles that can be drawn
+// from the bag and makes at least one word, with its number of solutions, so
+// blank quizzes can sample racks with the wanted number of solutions directly
+// instead of drawing racks until enough of them qualify.
+//
+// A rack's solutions are the words of every alphagram one tile longer than
+// its letters that contains them all, so the table is built from the
+// alphagram index without anagramming anything. It is saved next to the
+// gaddag, tagged with the gaddag's lexicon hash:
+//
+//   byte 0: kBlankRackTableVersion
+//   bytes 1-16: lexicon hash
+//   bytes 17, 18: kMinLength, kMaxLength
+//   bytes 24-27: number of racks
+//   from byte 32, per rack: the letters as a little-endian PackedRack value
+//   (16 bytes), then the number of solutions (4 bytes), also little-endian
+class BlankRackTable {
+ public:
+  static constexpr int kMinLength = 6;
+  static constexpr int kMaxLength = 9;
+
+  struct Rack {
+    // Every tile but the blank.
+    PackedRack letters;
+    int num_solutions;
+  };
+
+  BlankRackTable();
+
+  // Where the table for the gaddag at gaddag_path is kept.
+  static QString PathFor(const QString& gaddag_path);
+
+  void Build(const AlphagramIndex& index, const Bag& bag,
+             const QByteArray& hash);
+  bool Write(const QString& path) const;
+  // Fails if the file is missing or damaged, or was built for a lexicon
+  // other than expected_hash.
+  bool Read(const QString& path, const QByteArray& expected_hash);
+  bool IsEmpty() const { return racks_.empty(); }
+
+  const Rack& At(int rack) const { return racks_[rack]; }
+  // The rack's tiles, blank first.
+  WordString Tiles(int rack) const;
+  int NumRacks() const { return racks_.size(); }
+
+  // Adds up to count distinct racks, chosen uniformly from those with one of
+  // lengths tiles and between min_solutions and max_solutions solutions.
+  void Sample(const std::vector<int>& lengths, int min_solutions,
+              int max_solutions, int count, Random* random,
+              std::vector<int>* chosen) const;
+
+ private:
+  // Sorts the racks by length, number of solutions and letters, and finds
+  // where each length starts.
+  void Index();
+
+  QByteArray hash_;
+  std::vector<Rack> racks_;
+  // racks_ of length n start at length_starts_[n].
+  std::vector<int> length_starts_;
+};
+
+#endif  // BLANK_RACK_TABLE_H
@@ -0,0 +1,162 @@
+#ifndef COMPRESSED_GADDAG_H
+#define COMPRESSED_GADDAG_H
+
+#include <cstring>
+
+#include "gaddag.h"
+#include "gaddag_file.h"
+#include "util.h"
+
+// Reads GADDAG_COMPRESSED files. Most edges point at nearby nodes, so instead
+// of every edge holding an absolute 4-byte offset, each node picks the
+// narrowest edge width from 1 to 4 bytes that reaches all its children, and
+// each edge holds the child's signed offset from the edge itself.
+//
+// The width is kept both in the bitset's spare high bits, so Child() can
+// index straight to an edge, and in the low bits of every edge, so an edge
+// pointer can be followed on its own. A little-endian edge of width w is
+//
+//   bits 0-1: w - 1
+//   bit 2: the edge completes a word
+//   bits 3 to 8w-1: signed offset of the child from the edge, 0 for none
+//
+// The interface matches Gaddag's, so the anagrammers take either.
+// Compressed files carry no node info, word counts or lexicon masks.
+class CompressedGaddag {
+ public:
+  static constexpr bool kHasNodeInfo = false;
+  static constexpr int kWidthShift = LAST_LETTER + 1;
+  static constexpr uint32_t kLetterMask = (1u << kWidthShift) - 1;
+
+  explicit CompressedGaddag(const char* data, int flags = 0)
+      : data_(reinterpret_cast<const unsigned char*>(data)) {
+    (void)flags;
+  }
+
+  static inline uint32_t Load32(const unsigned char* data) {
+    uint32_t word;
+    memcpy(&word, data, sizeof(word));
+    return word;
+  }
+
+  // The narrowest edge width that can hold delta, or 0 if none can.
+  static int EdgeWidth(int64_t delta) {
+    for (int width = 1; width <= 4; ++width) {
+      const int64_t limit = 1LL << (8 * width - 4);
+      if (delta >= -limit && delta < limit) return width;
+    }
+    return 0;
+  }
+
+  inline const unsigned char* NextRackChild(const unsigned char* bitset_data,
+                                            Letter min_letter,
+                                            uint32_t rack_bits,
+                                            int* child_index,
+                                            Letter* next_letter) const {
+    const uint32_t bitset = Load32(bitset_data) & kLetterMask;
+    for (;;) {
+      const uint32_t inverse_mask = (1 << min_letter) - 1;
+      *next_letter = __builtin_ffs(bitset & (~inverse_mask)) - 1;
+      if (*next_letter > LAST_LETTER) {
+        return nullptr;
+      }
+      if (rack_bits & (1 << *next_letter)) {
+        break;
+      }
+      min_letter = *next_letter + 1;
+      (*child_index)++;
+    }
+    return Edge(bitset_data, *child_index);
+  }
+
+  inline const unsigned char* NextChild(const unsigned char* bitset_data,
+                                        Letter min_letter, int* child_index,
+                                        Letter* next_letter) const {
+    const uint32_t bitset = Load32(bitset_data) & kLetterMask;
+    const uint32_t inverse_mask = (1 << min_letter) - 1;
+    *next_letter = __builtin_ffs(bitset & (~inverse_mask)) - 1;
+    if (*next_letter > LAST_LETTER) return nullptr;
+    return Edge(bitset_data, *child_index);
+  }
+
+  bool HasAnyChild(const unsigned char* bitset_data, uint32_t rack_bits) const {
+    return (Load32(bitset_data) & kLetterMask & rack_bits) != 0;
+  }
+
+  inline bool HasChild(const unsigned char* bitset_data, Letter letter) const {
+    return (Load32(bitset_data) & kLetterMask & (1u << letter)) != 0;
+  }
+
+  int NumChildren(const unsigned char* bitset_data) const {
+    return __builtin_popcount(Load32(bitset_data) & kLetterMask);
+  }
+
+  inline const unsigned char*
+    ChangeDirection(const unsigned char* bitset_data) const {
+    if (HasChild(bitset_data, GADDAG_SEPARATOR)) {
+      return Edge(bitset_data, 0);
+    } else {
+      return nullptr;
+    }
+  }
+
+  inline const unsigned char*
+    Child(const unsigned char* bitset_data, Letter letter) const {
+    const uint32_t bitset = Load32(bitset_data) & kLetterMask;
+    uint32_t before_letter_mask = (1 << letter) - 1;
+    return Edge(bitset_data, __builtin_popcount(bitset & before_letter_mask));
+  }
+
+  inline bool CanPlaceAll(const unsigned char* /*bitset_data*/,
+                          uint32_t /*rack_bits*/, int /*num_tiles*/) const {
+    return true;
+  }
+
+  inline bool CanCompleteLength(const unsigned char* /*bitset_data*/,
+                                int /*min_letters*/,
+                                int /*max_letters*/) const {
+    return true;
+  }
+
+  inline uint32_t WordsBefore(const unsigned char* /*bitset_data*/,
+                              const unsigned char* /*index_data*/) const {
+    return 0;
+  }
+
+  inline int Lexicons(const unsigned char* /*bitset_data*/,
+                      const unsigned char* /*index_data*/) const {
+    return 1;
+  }
+
+  inline bool CompletesWord(const unsigned char* index_data) const {
+    return (index_data[0] & kTerminalBit) != 0;
+  }
+
+  inline const unsigned char* FollowIndex(
+      const unsigned char* index_data) const {
+    const int unused_bits = 32 - 8 * ((index_data[0] & kWidthMask) + 1);
+    // Sign-extend the edge from its width.
+    const int32_t edge =
+        static_cast<int32_t>(Load32(index_data) << unused_bits) >> unused_bits;
+    const int32_t delta = edge >> kDeltaShift;
+    if (delta == 0) return nullptr;
+    return index_data + delta;
+  }
+
+  inline const unsigned char* Root() const { return data_; }
+
+ private:
+  static constexpr int kWidthMask = 0x3;
+  static constexpr int kTerminalBit = 0x4;
+  static constexpr int kDeltaShift = 3;
+
+  inline const unsigned char* Edge(const unsigned char* bitset_data,
+                                   int index) const {
+    const int width = (Load32(bitset_data) >> kWidthShift) + 1;
+    return bitset_data + kGaddagWordSize + width * index;
+  }
+
+  const unsigned char* data_;
+};
+
+#endif  // COMPRESSED_GADDAG_H
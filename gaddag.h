@@ -2,26 +2,57 @@
 #define GADDAG_H
 
 #include <bitset>
+#include <cstring>
 
+#include "gaddag_file.h"
 #include "util.h"
 
 #define GADDAG_SEPARATOR 0
 
+// Reads nodes in either on-disk layout. Version 2 packs 4-byte bitsets with
+// kIndexSize-byte child indices counted in bytes, so most loads are
+// unaligned. Version 3 nodes are a 4-byte bitset followed by 4-byte edges
+// whose top bit marks termination and whose low bits count 4-byte words
+// (kIndexShift == 2), so every load is naturally aligned and none runs past
+// the end of a node.
+//
+// With GADDAG_NODE_INFO, kInfoSize bytes of letter and length bounds sit
+// between each bitset and its edges.
+//
+// The widths are template parameters so that child address arithmetic folds
+// to immediates; GaddagFile's header picks the instantiation once at load.
+template <int kBitsetSize, int kIndexSize, int kIndexShift = 0,
+          int kInfoSize = 0>
 class Gaddag {
  public:
-  Gaddag(const char* data, Letter last_letter, int bitset_size,
-         int index_size);
+  static constexpr bool kHasNodeInfo = kInfoSize > 0;
+
+  static_assert(kBitsetSize == 4, "bitsets are loaded as 32-bit words");
+  static_assert(kIndexSize >= 1 && kIndexSize <= 4,
+                "edges are loaded as 32-bit words");
+
+  // flags are the GaddagFlags from the file header.
+  explicit Gaddag(const char* data, int flags = 0)
+      : data_(reinterpret_cast<const unsigned char*>(data)),
+        edge_columns_((flags & GADDAG_WORD_COUNTS) ? 2 : 1),
+        has_lexicons_((flags & GADDAG_LEXICONS) != 0) {}
+
+  static inline uint32_t Load32(const unsigned char* data) {
+    uint32_t word;
+    memcpy(&word, data, sizeof(word));
+    return word;
+  }
 
   inline const unsigned char* NextRackChild(const unsigned char* bitset_data,
                                             Letter min_letter,
                                             uint32_t rack_bits,
                                             int* child_index,
                                             Letter* next_letter) const {
-    const uint32_t& bitset = *(reinterpret_cast<const uint32_t*>(bitset_data));
+    const uint32_t bitset = Load32(bitset_data);
     for (;;) {
       const uint32_t inverse_mask = (1 << min_letter) - 1;
       *next_letter = __builtin_ffs(bitset & (~inverse_mask)) - 1;
-      if (*next_letter > last_letter_) {
+      if (*next_letter > LAST_LETTER) {
         return nullptr;
       }
       if (rack_bits & (1 << *next_letter)) {
@@ -30,29 +61,30 @@ class Gaddag {
       min_letter = *next_letter + 1;
       (*child_index)++;
     }
-    return bitset_data + bitset_size_ + (index_size_ * (*child_index));
+    return bitset_data + kEdgesOffset + (kIndexSize * (*child_index));
   }
 
   inline const unsigned char* NextChild(const unsigned char* bitset_data,
                                         Letter min_letter, int* child_index,
                                         Letter* next_letter) const {
-    const uint32_t& bitset = *(reinterpret_cast<const uint32_t*>(bitset_data));
+    const uint32_t bitset = Load32(bitset_data);
     const uint32_t inverse_mask = (1 << min_letter) - 1;
     *next_letter = __builtin_ffs(bitset & (~inverse_mask)) - 1;
-    if (*next_letter > last_letter_) return nullptr;
-    return bitset_data + bitset_size_ + (index_size_ * (*child_index));
+    if (*next_letter > LAST_LETTER) return nullptr;
+    return bitset_data + kEdgesOffset + (kIndexSize * (*child_index));
   }
 
   uint32_t SharedChildren(const unsigned char* bitset_data1,
                           const unsigned char* bitset_data2) const;
   uint32_t Intersection(const unsigned char* bitset_data,
                         uint32_t rack_bits) const;
-  bool HasAnyChild(const unsigned char* bitset_data, uint32_t rack_bits) const;
+  bool HasAnyChild(const unsigned char* bitset_data, uint32_t rack_bits) const {
+    return (Load32(bitset_data) & rack_bits) != 0;
+  }
 
   inline bool HasChild(const unsigned char* bitset_data, Letter letter) const {
     uint32_t letter_mask = 1 << letter;
-    const uint32_t& bitset = *(reinterpret_cast<const uint32_t*>(bitset_data));
-    return (bitset & letter_mask) != 0;
+    return (Load32(bitset_data) & letter_mask) != 0;
   }
 
   int NumChildren(const unsigned char* bitset_data) const;
@@ -60,7 +92,7 @@ class Gaddag {
   inline const unsigned char*
     ChangeDirection(const unsigned char* bitset_data) const {
     if (HasChild(bitset_data, GADDAG_SEPARATOR)) {
-      return bitset_data + bitset_size_;
+      return bitset_data + kEdgesOffset;
     } else {
       return nullptr;
     }
@@ -68,34 +100,89 @@ class Gaddag {
 
   inline const unsigned char*
     Child(const unsigned char* bitset_data, Letter letter) const {
-    const uint32_t& bitset = *(reinterpret_cast<const uint32_t*>(bitset_data));
+    const uint32_t bitset = Load32(bitset_data);
     uint32_t before_letter_mask = (1 << letter) - 1;
     int index = __builtin_popcount(bitset & before_letter_mask);
-    return bitset_data + bitset_size_ + (index_size_ * index);
+    return bitset_data + kEdgesOffset + (kIndexSize * index);
+  }
+
+  // Rack bits of every letter on some path below the node.
+  inline uint32_t Letters(const unsigned char* bitset_data) const {
+    return Load32(bitset_data + kBitsetSize);
+  }
+
+  // The fewest and most letters on a path from the node to the end of a word.
+  inline int MinLength(const unsigned char* bitset_data) const {
+    return bitset_data[kBitsetSize + kGaddagWordSize];
+  }
+  inline int MaxLength(const unsigned char* bitset_data) const {
+    return bitset_data[kBitsetSize + kGaddagWordSize + 1];
+  }
+
+  // False if no path below the node can place exactly num_tiles tiles
+  // including every letter in rack_bits. Always true without node info.
+  inline bool CanPlaceAll(const unsigned char* bitset_data, uint32_t rack_bits,
+                          int num_tiles) const {
+    if (!kHasNodeInfo) return true;
+    return (rack_bits & ~Letters(bitset_data)) == 0 &&
+           num_tiles >= MinLength(bitset_data) &&
+           num_tiles <= MaxLength(bitset_data);
+  }
+
+  // False if every word below the node needs fewer than min_letters or more
+  // than max_letters more letters. Always true without node info.
+  inline bool CanCompleteLength(const unsigned char* bitset_data,
+                                int min_letters, int max_letters) const {
+    if (!kHasNodeInfo) return true;
+    return MaxLength(bitset_data) >= min_letters &&
+           MinLength(bitset_data) <= max_letters;
+  }
+
+  // With word counts, the number of words below the node that sort before the
+  // edge at index_data.
+  inline uint32_t WordsBefore(const unsigned char* bitset_data,
+                              const unsigned char* index_data) const {
+    const int num_children = __builtin_popcount(Load32(bitset_data));
+    return Load32(index_data + kIndexSize * num_children);
+  }
+
+  // With GADDAG_LEXICONS, the lexicons containing the word that ends at the
+  // edge at index_data; otherwise every word is in lexicon 0.
+  inline int Lexicons(const unsigned char* bitset_data,
+                      const unsigned char* index_data) const {
+    if (!has_lexicons_) return 1;
+    const int num_children = __builtin_popcount(Load32(bitset_data));
+    const unsigned char* edges = bitset_data + kEdgesOffset;
+    const int edge = (index_data - edges) / kIndexSize;
+    return edges[kIndexSize * num_children * edge_columns_ + edge];
   }
 
   inline bool CompletesWord(const unsigned char* index_data) const {
-    uint32_t data = *(reinterpret_cast<const uint32_t*>(index_data));
-    return (data & completes_word_mask_) != 0;
+    return (Load32(index_data) & kCompletesWordMask) != 0;
   }
 
   inline const unsigned char* FollowIndex(
       const unsigned char* index_data) const {
-    uint32_t data = *(reinterpret_cast<const uint32_t*>(index_data));
-    uint32_t index = data & index_mask_;
+    uint32_t index = Load32(index_data) & kIndexMask;
     if (index == 0) return nullptr;
-    return data_ + index;
+    return data_ + (static_cast<size_t>(index) << kIndexShift);
   }
 
   inline const unsigned char* Root() const { return data_; }
 
  private:
+  static constexpr uint32_t kCompletesWordMask = 1u << (kIndexSize * 8 - 1);
+  static constexpr uint32_t kIndexMask = kCompletesWordMask - 1;
+  static constexpr int kEdgesOffset = kBitsetSize + kInfoSize;
+
   const unsigned char* data_;
-  const Letter last_letter_;
-  const int bitset_size_;
-  const int index_size_;
-  const uint32_t completes_word_mask_;
-  const uint32_t index_mask_;
+  // Edges, then word counts if present, each one word per edge.
+  const int edge_columns_;
+  const bool has_lexicons_;
 };
 
+// Version 3 files.
+using AlignedGaddag = Gaddag<4, 4, 2>;
+using AnnotatedGaddag = Gaddag<4, 4, 2, kGaddagNodeInfoSize>;
+
 #endif
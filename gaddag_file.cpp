@@ -0,0 +1,194 @@
+#include <QtCore>
+
+#ifdef Q_OS_UNIX
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+
+#include "gaddag_file.h"
+
+namespace {
+qint64 PageSize() {
+#ifdef Q_OS_UNIX
+  return sysconf(_SC_PAGESIZE);
+#else
+  return 4096;
+#endif
+}
+}  // namespace
+
+GaddagFile::GaddagFile()
+    : mapping_(nullptr),
+      data_(nullptr),
+      size_(0),
+      version_(0),
+      header_size_(0),
+      last_letter_(0),
+      bitset_size_(0),
+      index_size_(0),
+      layout_(LAYOUT_DEPTH_FIRST),
+      flags_(0),
+      num_words_(0),
+      num_lexicons_(1) {}
+
+GaddagFile::~GaddagFile() { Close(); }
+
+void GaddagFile::Close() {
+  if (mapping_ != nullptr) {
+    file_.unmap(mapping_);
+    mapping_ = nullptr;
+  }
+  file_.close();
+  padded_copy_.clear();
+  data_ = nullptr;
+  size_ = 0;
+}
+
+bool GaddagFile::Open(const QString& path, AccessHint hint,
+                      const QByteArray& expected_hash) {
+  Close();
+  file_.setFileName(path);
+  if (!file_.open(QIODevice::ReadOnly)) {
+    qInfo() << "could not open" << path;
+    return false;
+  }
+  size_ = file_.size();
+  if (size_ < kGaddagV2HeaderSize + kGaddagWordSize) {
+    qInfo() << path << "is too small to be a gaddag:" << size_ << "bytes";
+    Close();
+    return false;
+  }
+  mapping_ = file_.map(0, size_);
+  // The mapping stays valid after the file is closed.
+  file_.close();
+  if (mapping_ == nullptr) {
+    qInfo() << "could not map" << path;
+    Close();
+    return false;
+  }
+  data_ = reinterpret_cast<const char*>(mapping_);
+  if (!ValidateHeader(expected_hash)) {
+    Close();
+    return false;
+  }
+
+  // Gaddag reads every edge as a 32-bit word, so in version 2 files the last
+  // edge of the last node is read up to 4 - index_size bytes past the end of
+  // the file. That's harmless while those bytes fall in the zero-filled tail
+  // of the last page, but not if the file ends exactly on a page boundary.
+  // Version 3 edges are whole words, and compressed files end in padding.
+  const qint64 overread = (version_ == 2) ? 4 - index_size_ : 0;
+  const qint64 tail = size_ % PageSize();
+  if (overread > 0 && (tail == 0 || PageSize() - tail < overread)) {
+    qInfo() << "copying gaddag to pad past the end of the last page";
+    padded_copy_ = QByteArray(data_, size_);
+    padded_copy_.append(QByteArray(overread, 0));
+    file_.unmap(mapping_);
+    mapping_ = nullptr;
+    data_ = padded_copy_.constData();
+    return true;
+  }
+  Advise(hint);
+  qInfo() << "mapped" << size_ << "byte gaddag from" << path;
+  return true;
+}
+
+bool GaddagFile::ValidateHeader(const QByteArray& expected_hash) {
+  version_ = static_cast<unsigned char>(data_[0]);
+  if (version_ != 2 && version_ != 3) {
+    qInfo() << "unsupported gaddag version" << version_;
+    return false;
+  }
+  header_size_ = (version_ == 2) ? kGaddagV2HeaderSize : kGaddagHeaderSize;
+  if (size_ < header_size_ + kGaddagWordSize) {
+    qInfo() << "gaddag is too small:" << size_ << "bytes";
+    return false;
+  }
+  hash_ = QByteArray(data_ + 1, kGaddagHashSize);
+  if (!expected_hash.isEmpty() && hash_ != expected_hash) {
+    qInfo() << "gaddag lexicon hash" << hash_.toHex() << "does not match"
+            << expected_hash.toHex();
+    return false;
+  }
+  last_letter_ = data_[1 + kGaddagHashSize];
+  bitset_size_ = data_[1 + kGaddagHashSize + 1];
+  index_size_ = data_[1 + kGaddagHashSize + 2];
+  if (last_letter_ != LAST_LETTER) {
+    qInfo() << "gaddag last letter" << last_letter_ << "is not" << LAST_LETTER;
+    return false;
+  }
+  // Gaddag loads bitsets and edges as 32-bit words.
+  if (bitset_size_ != 4) {
+    qInfo() << "unsupported gaddag bitset size" << bitset_size_;
+    return false;
+  }
+  layout_ = LAYOUT_DEPTH_FIRST;
+  flags_ = 0;
+  if (version_ >= 3) {
+    const int layout = static_cast<unsigned char>(data_[kGaddagLayoutOffset]);
+    if (layout >= kGaddagNumLayouts) {
+      qInfo() << "unsupported gaddag layout" << layout;
+      return false;
+    }
+    layout_ = static_cast<GaddagLayout>(layout);
+    flags_ = static_cast<unsigned char>(data_[kGaddagFlagsOffset]);
+  }
+  if (flags_ & ~kGaddagKnownFlags) {
+    qInfo() << "unsupported gaddag flags" << flags_;
+    return false;
+  }
+  if (IsCompressed()) {
+    if (index_size_ != 0 || (flags_ & ~(GADDAG_COMPRESSED | GADDAG_DAWG))) {
+      qInfo() << "unsupported compressed gaddag: index size" << index_size_
+              << "flags" << flags_;
+      return false;
+    }
+  } else if (index_size_ < 1 || index_size_ > 4) {
+    qInfo() << "unsupported gaddag index size" << index_size_;
+    return false;
+  } else if (version_ >= 3 && (index_size_ != kGaddagWordSize ||
+                               NodeDataSize() % kGaddagWordSize)) {
+    qInfo() << "version" << version_ << "gaddag is not word aligned";
+    return false;
+  }
+  num_words_ = 0;
+  if (HasWordCounts()) {
+    uint32_t num_words;
+    memcpy(&num_words, data_ + kGaddagWordCountOffset, sizeof(num_words));
+    num_words_ = num_words;
+  }
+  num_lexicons_ = 1;
+  if (flags_ & GADDAG_LEXICONS) {
+    num_lexicons_ = static_cast<unsigned char>(data_[kGaddagLexiconCountOffset]);
+    if (num_lexicons_ < 1 || num_lexicons_ > kGaddagMaxLexicons) {
+      qInfo() << "unsupported number of lexicons" << num_lexicons_;
+      return false;
+    }
+  }
+  return true;
+}
+
+void GaddagFile::Advise(AccessHint hint) {
+  switch (hint) {
+    case NO_HINT:
+      break;
+    case RANDOM:
+#ifdef Q_OS_UNIX
+      madvise(mapping_, size_, MADV_RANDOM);
+#endif
+      break;
+    case WILL_NEED:
+#ifdef Q_OS_UNIX
+      madvise(mapping_, size_, MADV_WILLNEED);
+#endif
+      break;
+    case POPULATE: {
+      const qint64 page_size = PageSize();
+      volatile char sum = 0;
+      for (qint64 i = 0; i < size_; i += page_size) {
+        sum += data_[i];
+      }
+      break;
+    }
+  }
+}
@@ -0,0 +1,144 @@
+#ifndef GADDAG_FILE_H
+#define GADDAG_FILE_H
+
+#include <QByteArray>
+#include <QFile>
+
+#include "util.h"
+
+constexpr int kGaddagVersion = 3;
+constexpr int kGaddagHashSize = 16;
+constexpr int kGaddagWordSize = 4;
+
+// version, hash, last letter, bitset size, index size
+constexpr int kGaddagV2HeaderSize = 1 + kGaddagHashSize + 3;
+// Version 3 zero-pads the header so that the root starts on a word boundary.
+constexpr int kGaddagHeaderSize = 32;
+constexpr int kGaddagLayoutOffset = kGaddagV2HeaderSize;
+constexpr int kGaddagFlagsOffset = kGaddagLayoutOffset + 1;
+// With GADDAG_WORD_COUNTS, the number of words in the lexicon.
+constexpr int kGaddagWordCountOffset = 24;
+// With GADDAG_LEXICONS, the number of lexicons the words came from.
+constexpr int kGaddagLexiconCountOffset = 28;
+constexpr int kGaddagMaxLexicons = 8;
+
+// Optional per-node data, flagged in the version 3 header.
+enum GaddagFlag {
+  // Each bitset is followed by kGaddagNodeInfoSize bytes: a word with the
+  // union of the letters below the node (as rack bits), then a word with the
+  // fewest letters on a path to the end of a word in the low byte and the
+  // most in the next byte.
+  GADDAG_NODE_INFO = 1 << 0,
+  // The file is a DAWG: words are stored forward from the root with no
+  // separator or reversed prefixes. Enough for anagramming, at a fraction of
+  // the size.
+  GADDAG_DAWG = 1 << 1,
+  // Each node's edges are followed by one word per edge: the number of words
+  // below the node that sort before the edge's letter. Words are numbered
+  // alphabetically, a word before its extensions. A GADDAG root counts whole
+  // words, through each first letter's separator, rather than patterns.
+  GADDAG_WORD_COUNTS = 1 << 2,
+  // The words come from several lexicons. After the edges (and word counts)
+  // each node has one byte per edge, zero-padded to a word: for a terminal
+  // edge, a bitmask of the lexicons that contain the word ending there.
+  GADDAG_LEXICONS = 1 << 3,
+  // Nodes are byte-aligned and each node's edges are 1 to 4 bytes wide,
+  // holding the child's offset relative to the edge; see CompressedGaddag.
+  // The header's index size is 0. Can't be combined with the flags above
+  // other than GADDAG_DAWG.
+  GADDAG_COMPRESSED = 1 << 4
+};
+constexpr int kGaddagKnownFlags = GADDAG_NODE_INFO | GADDAG_DAWG |
+                                  GADDAG_WORD_COUNTS | GADDAG_LEXICONS |
+                                  GADDAG_COMPRESSED;
+constexpr int kGaddagNodeInfoSize = 2 * kGaddagWordSize;
+
+// The order GaddagMaker writes nodes in. Readers don't depend on it; it only
+// changes which nodes share cache lines and pages.
+enum GaddagLayout {
+  // Preorder, the only layout before version 3.
+  LAYOUT_DEPTH_FIRST,
+  // The top few levels breadth-first, then the rest depth-first.
+  LAYOUT_BREADTH_FIRST,
+  // van Emde Boas-style: the top half of the levels as one block, then each
+  // subtree hanging off it, recursively.
+  LAYOUT_BLOCKED,
+  // Most-visited nodes first, from visit counts recorded by replaying a
+  // representative rack log.
+  LAYOUT_PROFILE_GUIDED
+};
+constexpr int kGaddagNumLayouts = LAYOUT_PROFILE_GUIDED + 1;
+
+// A GADDAG file written by GaddagMaker, mapped read-only into memory. Nothing
+// is copied: the node data handed to Gaddag points straight into the mapping,
+// so pages are faulted in lazily and shared through the page cache by every
+// process that has the same lexicon open.
+class GaddagFile {
+ public:
+  enum AccessHint {
+    NO_HINT,
+    // Traversal jumps all over the file, so skip the kernel's readahead.
+    RANDOM,
+    // Ask the kernel to start reading the whole file in the background.
+    WILL_NEED,
+    // Fault every page in before Open() returns.
+    POPULATE
+  };
+
+  GaddagFile();
+  ~GaddagFile();
+
+  // Maps the file at path and validates its header. If expected_hash is not
+  // empty, the lexicon hash stored in the file must match it.
+  bool Open(const QString& path, AccessHint hint = NO_HINT,
+            const QByteArray& expected_hash = QByteArray());
+  void Close();
+  bool IsOpen() const { return data_ != nullptr; }
+
+  int Version() const { return version_; }
+  const QByteArray& Hash() const { return hash_; }
+  Letter LastLetter() const { return last_letter_; }
+  int BitsetSize() const { return bitset_size_; }
+  int IndexSize() const { return index_size_; }
+  GaddagLayout Layout() const { return layout_; }
+  int Flags() const { return flags_; }
+  bool HasNodeInfo() const { return (flags_ & GADDAG_NODE_INFO) != 0; }
+  bool IsDawg() const { return (flags_ & GADDAG_DAWG) != 0; }
+  bool IsCompressed() const { return (flags_ & GADDAG_COMPRESSED) != 0; }
+  bool HasWordCounts() const { return (flags_ & GADDAG_WORD_COUNTS) != 0; }
+  // Without GADDAG_LEXICONS every word reads as being in lexicon 0 only,
+  // which says nothing about which lexicon that is.
+  bool HasLexicons() const { return (flags_ & GADDAG_LEXICONS) != 0; }
+  // Zero without word counts.
+  int NumWords() const { return num_words_; }
+  // One unless the file has GADDAG_LEXICONS.
+  int NumLexicons() const { return num_lexicons_; }
+
+  // The root node; child indices in the file are relative to this.
+  const char* NodeData() const { return data_ + header_size_; }
+  qint64 NodeDataSize() const { return size_ - header_size_; }
+
+ private:
+  bool ValidateHeader(const QByteArray& expected_hash);
+  void Advise(AccessHint hint);
+
+  QFile file_;
+  uchar* mapping_;
+  // Only used when the mapping can't be read safely up to the last edge.
+  QByteArray padded_copy_;
+  const char* data_;
+  qint64 size_;
+
+  int version_;
+  int header_size_;
+  QByteArray hash_;
+  Letter last_letter_;
+  int bitset_size_;
+  int index_size_;
+  GaddagLayout layout_;
+  int flags_;
+  int num_words_;
+  int num_lexicons_;
+};
+
+#endif  // GADDAG_FILE_H
@@ -1,49 +1,105 @@
 #include <bitset>
 #include <iostream>
+#include <queue>
+#include <tuple>
 
 #include <QByteArray>
 #include <QtCore>
 #include <QCryptographicHash>
 
+#include "compressed_gaddag.h"
+#include "gaddag_file.h"
 #include "gaddag_maker.h"
 #include "util.h"
 
-constexpr int kGaddagVersion = 2;
+namespace {
+// Compressed files end in this many zero bytes so that the last edge can be
+// loaded as a whole word.
+constexpr int kCompressedPadding = kGaddagWordSize;
+
+inline void ULongToBytes(unsigned long ulong, int length, char* bytes,
+                         bool flip_endian) {
+  for (int i = 0; i < length; ++i) {
+    const int shift = i * 8;
+    int dest_i = flip_endian ? length - 1 - i : i;
+    bytes[dest_i] = (ulong >> shift) & 0xFF;
+  }
+}
+}  // namespace
 
 GaddagMaker::GaddagMaker(bool make_dawg, bool flip_endian) {
-  root.terminates = false;
-  root.c = DELIMITER;
+  memset(hash.charptr, 0, sizeof(hash.charptr));
   this->make_dawg = make_dawg;
   this->flip_endian = flip_endian;
 }
 
 bool GaddagMaker::MakeGaddag(const QString& input_path,
                              const QString& output_path) {
-  qInfo() << "input_path: " << input_path;
-  qInfo() << "output_path: " << output_path;
+  return MakeGaddag(vector<QString>{input_path}, output_path);
+}
 
+bool GaddagMaker::MakeGaddag(const vector<QString>& input_paths,
+                             const QString& output_path) {
+  qInfo() << "output_path: " << output_path;
+  map<WordString, int> lexicons;
+  if (!ReadLexicons(input_paths, &lexicons)) return false;
   gaddag_patterns.clear();
-  QFile input(input_path);
-  if (input.open(QIODevice::ReadOnly)) {
+  for (const auto& word_and_lexicons : lexicons) {
+    HashWord(word_and_lexicons.first, word_and_lexicons.second);
+    GaddagizeWord(word_and_lexicons.first, word_and_lexicons.second);
+  }
+  Generate();
+  return Write(output_path);
+}
+
+bool GaddagMaker::HashLexicon(const vector<QString>& input_paths,
+                              QByteArray* hash_bytes) {
+  map<WordString, int> lexicons;
+  if (!ReadLexicons(input_paths, &lexicons)) return false;
+  for (const auto& word_and_lexicons : lexicons) {
+    HashWord(word_and_lexicons.first, word_and_lexicons.second);
+  }
+  *hash_bytes = QByteArray(hash.charptr, sizeof(hash.charptr));
+  return true;
+}
+
+bool GaddagMaker::ReadLexicons(const vector<QString>& input_paths,
+                               map<WordString, int>* lexicons) {
+  if (input_paths.empty() || input_paths.size() > kGaddagMaxLexicons) {
+    qInfo() << "can't merge" << input_paths.size() << "lexicons";
+    return false;
+  }
+  num_lexicons = input_paths.size();
+  memset(hash.charptr, 0, sizeof(hash.charptr));
+  for (size_t i = 0; i < input_paths.size(); ++i) {
+    qInfo() << "input_path: " << input_paths[i];
+    QFile input(input_paths[i]);
+    if (!input.open(QIODevice::ReadOnly)) {
+      qInfo() << "could not open input file";
+      return false;
+    }
     QTextStream in(&input);
     while (!in.atEnd()) {
       QString word = in.readLine();
-      if (!GaddagizeWord(word)) {
+      const WordString word_string = Util::EncodeWord(word);
+      if (word_string.empty()) {
         qInfo() << "Could not encode word " << word;
+        continue;
       }
+      (*lexicons)[word_string] |= 1 << i;
     }
-  } else {
-    qInfo() << "could not open input file";
-    return false;
   }
-  Generate();
-  Write(output_path);
   return true;
 }
 
-void GaddagMaker::HashWord(const WordString& word) {
+void GaddagMaker::HashWord(const WordString& word, int lexicons) {
   QCryptographicHash word_hash(QCryptographicHash::Md5);
   word_hash.addData(word.constData(), word.length());
+  // A single lexicon hashes the same as it always has.
+  if (num_lexicons > 1) {
+    const char lexicons_byte = lexicons;
+    word_hash.addData(&lexicons_byte, 1);
+  }
   QByteArray hash_bytes = word_hash.result();
   hash.int32ptr[0] ^= ((const int32_t*)hash_bytes.constData())[0];
   hash.int32ptr[1] ^= ((const int32_t*)hash_bytes.constData())[1];
@@ -51,19 +107,9 @@ void GaddagMaker::HashWord(const WordString& word) {
   hash.int32ptr[3] ^= ((const int32_t*)hash_bytes.constData())[3];
 }
 
-bool GaddagMaker::GaddagizeWord(const QString& word) {
-  const WordString word_string = Util::EncodeWord(word);
-  if (word_string.empty()) {
-    return false;
-  }
-  HashWord(word_string);
-  GaddagizeWord(word_string);
-  return true;
-}
-
-void GaddagMaker::GaddagizeWord(const WordString& word) {
+void GaddagMaker::GaddagizeWord(const WordString& word, int lexicons) {
   if (make_dawg) {
-    gaddag_patterns.push_back(word);
+    gaddag_patterns.push_back({word, lexicons});
     return;
   }
   for (size_t switch_index = 0; switch_index <= word.size(); ++switch_index) {
@@ -77,7 +123,7 @@ void GaddagMaker::GaddagizeWord(const WordString& word) {
         pattern.push_back(word[i]);
       }
     }
-    gaddag_patterns.push_back(pattern);
+    gaddag_patterns.push_back({pattern, lexicons});
   }
 }
 
@@ -85,38 +131,60 @@ void GaddagMaker::Generate() {
   qInfo() << "we have" << gaddag_patterns.size() << "gaddag patterns";
   sort(gaddag_patterns.begin(), gaddag_patterns.end());
   qInfo() << "sorted them";
-  for (const WordString& pattern : gaddag_patterns) {
-    root.PushWord(pattern);
+  // path[i] is the edge for the ith letter of the last pattern added, and
+  // path[0] the root. Patterns arrive sorted, so an edge is finished as soon
+  // as a pattern leaves it, and only the last child of each edge on the
+  // path can still grow.
+  vector<Node*> path = {&root};
+  WordString previous;
+  for (const auto& pattern : gaddag_patterns) {
+    const WordString& word = pattern.first;
+    size_t shared = 0;
+    while (shared < word.length() && shared < previous.length() &&
+           word[shared] == previous[shared]) {
+      ++shared;
+    }
+    for (size_t depth = path.size() - 1; depth > shared; --depth) {
+      Finish(path[depth]);
+    }
+    path.resize(shared + 1);
+    for (size_t i = shared; i < word.length(); ++i) {
+      Node edge;
+      edge.c = word[i];
+      path.back()->children.push_back(edge);
+      path.push_back(&path.back()->children.back());
+    }
+    path.back()->terminates = true;
+    path.back()->lexicons |= pattern.second;
+    previous = word;
+  }
+  for (size_t depth = path.size() - 1; depth > 0; --depth) {
+    Finish(path[depth]);
   }
+  vector<std::pair<WordString, int>>().swap(gaddag_patterns);
+  registry.clear();
+  qInfo() << "registered" << states.size() << "nodes";
 }
 
-void GaddagMaker::Node::PushWord(const WordString& word) {
-  if (word.length() == 0) {
-    terminates = true;
-    return;
+void GaddagMaker::Finish(Node* edge) {
+  if (edge->children.empty()) return;
+  std::string key;
+  key.reserve(edge->children.size() * (3 + sizeof(Node*)));
+  for (const Node& child : edge->children) {
+    key.push_back(child.c);
+    key.push_back(child.terminates);
+    key.push_back(child.lexicons);
+    const Node* const next = child.state;
+    key.append(reinterpret_cast<const char*>(&next), sizeof(next));
   }
-
-  const Letter first = word[0];
-  const WordString rest = word.substr(1, word.length() - 1);
-
-  int index = -1;
-  for (size_t i = 0; i < children.size(); i++) {
-    if (children[i].c == first) {
-      index = i;
-      break;
-    }
-  }
-
-  if (index < 0) {
-    Node n;
-    n.c = first;
-    n.terminates = false;
-    n.duplicate = nullptr;
-    children.push_back(n);
-    index = children.size() - 1;
+  auto found = registry.find(key);
+  if (found == registry.end()) {
+    states.emplace_back();
+    states.back().children.swap(edge->children);
+    found = registry.emplace(key, &states.back()).first;
   }
-
-  children[index].PushWord(rest);
+  vector<Node>().swap(edge->children);
+  edge->state = found->second;
 }
 
 bool GaddagMaker::Write(const QString& output_path) {
@@ -127,58 +195,197 @@ bool GaddagMaker::Write(const QString& output_path) {
     output.putChar(kGaddagVersion);
     output.write(hash.charptr, sizeof(hash.charptr));
 
-    int bitsets = 0;
-    int indices = 0;
-    map<QByteArray, vector<Node*>> by_hash;
-    Node::BinByHash(&root, &by_hash);
-    Node::MarkDuplicates(by_hash);
-    root.Number(&bitsets, &indices);
+    vector<Node*> order;
+    Order(&order);
+    if (compressed) {
+      const bool written = WriteCompressed(order, &output);
+      output.close();
+      return written;
+    }
 
+    // Each node is a one-word bitset followed by a one-word edge per child.
+    // The top bit of an edge marks termination and the rest is the child's
+    // offset from the root in words, so every load is aligned.
     const int alphabet_size = LAST_LETTER + 1;
-    const int num_child_bytes = (alphabet_size + 8 - 1) / 8;
-    qInfo() << "num_child_bytes: " << num_child_bytes;
-    int num_index_bytes = 1;
-    for (; num_index_bytes < 8; ++num_index_bytes) {
-      int64_t bytes_addressable = 1L << (num_index_bytes * 8);
-      if (bytes_addressable >
-          2 * (num_child_bytes * bitsets + num_index_bytes * indices)) {
-        break;
-      }
+    static_assert(alphabet_size <= kGaddagWordSize * 8,
+                  "bitset must fit in one word");
+    const int num_child_bytes = kGaddagWordSize;
+    const int num_info_bytes = node_info ? kGaddagNodeInfoSize : 0;
+    const int num_index_bytes = kGaddagWordSize;
+    const int num_count_bytes = word_counts ? kGaddagWordSize : 0;
+    const bool lexicon_masks = num_lexicons > 1;
+    const int num_lexicon_bytes = lexicon_masks ? 1 : 0;
+    int64_t num_words = 0;
+    for (Node* node : order) {
+      node->offset = num_words;
+      const int num_edges = node->children.size();
+      const int lexicon_bytes = num_edges * num_lexicon_bytes;
+      num_words +=
+          (num_child_bytes + num_info_bytes +
+           num_edges * (num_index_bytes + num_count_bytes) +
+           (lexicon_bytes + kGaddagWordSize - 1) / kGaddagWordSize *
+               kGaddagWordSize) / kGaddagWordSize;
     }
-    qInfo() << "num_index_bytes: " << num_index_bytes;
+    if (num_words >= (1LL << (num_index_bytes * 8 - 1))) {
+      qInfo() << "too many nodes to address:" << num_words << "words";
+      output.close();
+      return false;
+    }
+    qInfo() << "num_words: " << num_words;
     output.putChar(LAST_LETTER);
     output.putChar(num_child_bytes);
     output.putChar(num_index_bytes);
-    Write(root, num_child_bytes, num_index_bytes, &output);
+    output.putChar(layout);
+    output.putChar((node_info ? GADDAG_NODE_INFO : 0) |
+                   (make_dawg ? GADDAG_DAWG : 0) |
+                   (word_counts ? GADDAG_WORD_COUNTS : 0) |
+                   (lexicon_masks ? GADDAG_LEXICONS : 0));
+    output.write(
+        QByteArray(kGaddagWordCountOffset - kGaddagFlagsOffset - 1, 0));
+    // In a GADDAG the root numbers whole words: each first letter counts the
+    // words through its separator rather than every pattern below it.
+    const bool root_through_separator = !make_dawg;
+    int64_t lexicon_words = 0;
+    if (word_counts) {
+      root.CountWords();
+      for (const Node& child : root.children) {
+        lexicon_words += child.EdgeWords(root_through_separator);
+      }
+      qInfo() << "numbering" << lexicon_words << "words";
+    }
+    char lexicon_words_bytes[kGaddagWordSize];
+    ULongToBytes(lexicon_words, kGaddagWordSize, lexicon_words_bytes,
+                 flip_endian);
+    output.write(lexicon_words_bytes, kGaddagWordSize);
+    output.putChar(lexicon_masks ? num_lexicons : 0);
+    output.write(QByteArray(
+        kGaddagHeaderSize - kGaddagLexiconCountOffset - 1, 0));
+    if (node_info) {
+      root.Annotate();
+    }
+    for (const Node* node : order) {
+      output.write(node->GetBytes(num_child_bytes, num_info_bytes,
+                                  num_index_bytes, num_count_bytes,
+                                  num_lexicon_bytes,
+                                  root_through_separator && node == &root,
+                                  flip_endian));
+    }
   }
   output.close();
   return true;
 }
 
-namespace {
-inline void ULongToBytes(unsigned long ulong, int length, char* bytes,
-                         bool flip_endian) {
-  for (int i = 0; i < length; ++i) {
-    const int shift = i * 8;
-    int dest_i = flip_endian ? length - 1 - i : i;
-    bytes[dest_i] = (ulong >> shift) & 0xFF;
+bool GaddagMaker::WriteCompressed(const vector<Node*>& order,
+                                  QFile* output) {
+  if (node_info || word_counts || num_lexicons > 1 || flip_endian) {
+    qInfo() << "compressed gaddags can't have node info, word counts,"
+            << "several lexicons or flipped endianness";
+    return false;
   }
+  // Widths only grow, and a node's edges move when an earlier node's widths
+  // grow, so widen until every edge reaches its child.
+  int64_t num_bytes = 0;
+  for (bool widened = true; widened;) {
+    widened = false;
+    num_bytes = 0;
+    for (Node* node : order) {
+      node->offset = num_bytes;
+      num_bytes += kGaddagWordSize + node->width * node->children.size();
+    }
+    for (Node* node : order) {
+      int width = node->width;
+      for (size_t i = 0; i < node->children.size(); ++i) {
+        const Node* child = node->children[i].Canonical();
+        if (child->children.empty()) continue;
+        const int64_t edge = node->offset + kGaddagWordSize + node->width * i;
+        const int needed = CompressedGaddag::EdgeWidth(child->offset - edge);
+        if (needed == 0) {
+          qInfo() << "edge is too long to compress";
+          return false;
+        }
+        width = std::max(width, needed);
+      }
+      if (width > node->width) {
+        node->width = width;
+        widened = true;
+      }
+    }
+  }
+  int64_t width_counts[5] = {0};
+  for (const Node* node : order) {
+    width_counts[node->width] += node->children.size();
+  }
+  qInfo() << "num_bytes:" << num_bytes << "edges of width 1-4:"
+          << width_counts[1] << width_counts[2] << width_counts[3]
+          << width_counts[4];
+
+  output->putChar(LAST_LETTER);
+  output->putChar(kGaddagWordSize);
+  output->putChar(0);
+  output->putChar(layout);
+  output->putChar(GADDAG_COMPRESSED | (make_dawg ? GADDAG_DAWG : 0));
+  output->write(QByteArray(kGaddagHeaderSize - kGaddagFlagsOffset - 1, 0));
+  for (const Node* node : order) {
+    uint32_t bitset = (node->width - 1) << CompressedGaddag::kWidthShift;
+    for (const Node& child : node->children) {
+      bitset |= 1u << child.c;
+    }
+    char bytes[kGaddagWordSize];
+    ULongToBytes(bitset, kGaddagWordSize, bytes, false);
+    output->write(bytes, kGaddagWordSize);
+    for (size_t i = 0; i < node->children.size(); ++i) {
+      const Node& child = node->children[i];
+      const Node* target = child.Canonical();
+      int64_t delta = 0;
+      if (!target->children.empty()) {
+        delta = target->offset -
+                (node->offset + kGaddagWordSize + node->width * i);
+      }
+      const int64_t edge =
+          delta * 8 + (child.terminates ? 0x4 : 0) + (node->width - 1);
+      ULongToBytes(edge, node->width, bytes, false);
+      output->write(bytes, node->width);
+    }
+  }
+  output->write(QByteArray(kCompressedPadding, 0));
+  return true;
 }
-}  // namespace
 
 QByteArray GaddagMaker::Node::GetBytes(int num_child_bytes,
+                                       int num_info_bytes,
                                        int num_index_bytes,
+                                       int num_count_bytes,
+                                       int num_lexicon_bytes,
+                                       bool through_separator,
                                        bool flip_endian) const {
   QByteArray ret;
   int num_child_pointer_bytes = children.size() * num_index_bytes;
   char child_pointer_bytes[num_child_pointer_bytes];
+  int num_word_count_bytes = children.size() * num_count_bytes;
+  char word_count_bytes[num_word_count_bytes];
+  int64_t words_before = 0;
+  // Padded so that the next node starts on a word.
+  const int num_lexicon_mask_bytes =
+      (children.size() * num_lexicon_bytes + kGaddagWordSize - 1) /
+      kGaddagWordSize * kGaddagWordSize;
+  QByteArray lexicon_mask_bytes(num_lexicon_mask_bytes, 0);
   std::bitset<64> child_bits;
   int offset = 0;
   for (const Node& child : children) {
-    const Node& child_for_pointer =
-        (child.duplicate == nullptr) ? child : *child.duplicate;
-    unsigned long child_index = num_child_bytes * child_for_pointer.bitsets +
-                                num_index_bytes * child_for_pointer.indices;
+    const Node& child_for_pointer = *child.Canonical();
+    unsigned long child_index = 0;
+    if (!child_for_pointer.children.empty()) {
+      child_index = child_for_pointer.offset;
+    }
+    if (num_count_bytes > 0) {
+      ULongToBytes(words_before, num_count_bytes,
+                   word_count_bytes + offset / num_index_bytes * num_count_bytes,
+                   flip_endian);
+      words_before += child.EdgeWords(through_separator);
+    }
+    if (num_lexicon_bytes > 0 && child.terminates) {
+      lexicon_mask_bytes[offset / num_index_bytes] = child.lexicons;
+    }
     ULongToBytes(child_index, num_index_bytes, child_pointer_bytes + offset,
                  flip_endian);
     if (child.terminates) {
@@ -195,89 +402,253 @@ QByteArray GaddagMaker::Node::GetBytes(int num_child_bytes,
   char child_bytes[num_child_bytes];
   ULongToBytes(child_bits_int, num_child_bytes, child_bytes, flip_endian);
   ret.append(child_bytes, num_child_bytes);
+  if (num_info_bytes > 0) {
+    char info_bytes[kGaddagNodeInfoSize];
+    ULongToBytes(letters, kGaddagWordSize, info_bytes, flip_endian);
+    ULongToBytes(min_length | (max_length << 8), kGaddagWordSize,
+                 info_bytes + kGaddagWordSize, flip_endian);
+    ret.append(info_bytes, kGaddagNodeInfoSize);
+  }
   ret.append(child_pointer_bytes, num_child_pointer_bytes);
+  ret.append(word_count_bytes, num_word_count_bytes);
+  ret.append(lexicon_mask_bytes);
   return ret;
 }
 
-void GaddagMaker::Write(const Node& node, int num_child_bytes,
-                        int num_index_bytes, QFile* output) {
-  QByteArray bytes = node.GetBytes(num_child_bytes, num_index_bytes,
-                                   flip_endian);
-  output->write(bytes);
-  for (const Node& child : node.children) {
-    if (child.duplicate == nullptr && !child.children.empty()) {
-      Write(child, num_child_bytes, num_index_bytes, output);
+void GaddagMaker::Order(vector<Node*>* order) {
+  switch (layout) {
+    case LAYOUT_DEPTH_FIRST:
+      break;
+    case LAYOUT_BREADTH_FIRST:
+      OrderBreadthFirst(order);
+      break;
+    case LAYOUT_BLOCKED: {
+      vector<Node*> frontier;
+      OrderBlocked(&root, root.GetDepth(), order, &frontier);
+      break;
     }
+    case LAYOUT_PROFILE_GUIDED:
+      OrderProfileGuided(order);
+      break;
   }
+  // Whatever the layout didn't place goes after it in preorder.
+  OrderDepthFirst(&root, order);
+  qInfo() << "laid out" << order->size() << "nodes";
 }
 
-void GaddagMaker::Node::Number(int* bitsets, int* indices) {
-  if (children.empty()) {
-    this->bitsets = 0;
-    this->indices = 0;
-    return;
+void GaddagMaker::OrderDepthFirst(Node* node, vector<Node*>* order) {
+  if (node->walked) return;
+  node->walked = true;
+  if (!node->placed) {
+    node->placed = true;
+    order->push_back(node);
   }
-  this->bitsets = *bitsets;
-  this->indices = *indices;
-  ++(*bitsets);
-  (*indices) += children.size();
-  for (Node& child : children) {
-    if (child.duplicate == nullptr) {
-      child.Number(bitsets, indices);
+  for (Node& child : node->children) {
+    Node* next = child.Canonical();
+    if (!next->children.empty()) {
+      OrderDepthFirst(next, order);
     }
   }
 }
 
-void GaddagMaker::Node::BinByHash(Node* node,
-                                  map<QByteArray, vector<Node*>>* by_hash) {
-  (*by_hash)[node->GetHash()].push_back(node);
-  for (Node& child : node->children) {
-    BinByHash(&child, by_hash);
+namespace {
+// Levels scanned breadth-first. The level below the last one scanned is
+// placed too, so this lays out the root plus the first four letters, which
+// every anagram query passes through.
+constexpr int kBreadthFirstLevels = 4;
+}  // namespace
+
+void GaddagMaker::OrderBreadthFirst(vector<Node*>* order) {
+  vector<Node*> level = {&root};
+  root.placed = true;
+  for (int depth = 0; depth < kBreadthFirstLevels; ++depth) {
+    vector<Node*> next_level;
+    for (Node* node : level) {
+      order->push_back(node);
+      for (Node& child : node->children) {
+        Node* next = child.Canonical();
+        if (!next->placed && !next->children.empty()) {
+          next->placed = true;
+          next_level.push_back(next);
+        }
+      }
+    }
+    level.swap(next_level);
+  }
+  // The next level was reserved while scanning; place it before descending.
+  for (Node* node : level) {
+    order->push_back(node);
   }
 }
 
-const QByteArray& GaddagMaker::Node::GetHash() {
-  if (hash.isEmpty()) {
-    QCryptographicHash h(QCryptographicHash::Md5);
-    h.addData("foo");
-    for (Node& node : children) {
-      QByteArray nodec;
-      nodec.append(node.c);
-      h.addData(nodec);
-      h.addData(node.terminates ? "." : "-");
-      h.addData(node.GetHash());
+void GaddagMaker::OrderBlocked(Node* node, int height, vector<Node*>* order,
+                               vector<Node*>* frontier) {
+  if (node->placed) return;
+  if (height <= 1) {
+    node->placed = true;
+    order->push_back(node);
+    for (Node& child : node->children) {
+      Node* next = child.Canonical();
+      if (!next->placed && !next->children.empty()) {
+        frontier->push_back(next);
+      }
     }
-    hash = h.result();
+    return;
+  }
+  const int top_height = height / 2;
+  vector<Node*> middle;
+  OrderBlocked(node, top_height, order, &middle);
+  for (Node* bottom : middle) {
+    OrderBlocked(bottom, height - top_height, order, frontier);
   }
-  return hash;
 }
 
-void GaddagMaker::Node::MarkDuplicates(
-    const map<QByteArray, vector<Node*>>& by_hash) {
-  for (const auto hash_pair : by_hash) {
-    for (size_t i = 0; i < hash_pair.second.size(); ++i) {
-      Node* node_i = hash_pair.second[i];
-      if (node_i->duplicate != NULL) continue;
-      for (unsigned int j = i + 1; j < hash_pair.second.size(); ++j) {
-        Node* node_j = hash_pair.second[j];
-        if (node_i->SameAs(*node_j)) {
-          node_j->duplicate = node_i;
-        } else {
-          qInfo() << "collision... i: " << i << " j: " << j << endl;
-        }
+void GaddagMaker::OrderProfileGuided(vector<Node*>* order) {
+  if (!CountVisits()) return;
+  // Grow the placed region from the root, always taking the most-visited
+  // node on its boundary, so hot paths end up packed together at the front.
+  // Ties go to the node reached first, not to whichever has the higher
+  // address, so the layout is the same on every run.
+  using Entry = std::tuple<int64_t, int64_t, Node*>;
+  std::priority_queue<Entry> frontier;
+  int64_t reached = 0;
+  frontier.push(Entry(root.visits, -reached++, &root));
+  while (!frontier.empty()) {
+    Node* node = std::get<2>(frontier.top());
+    frontier.pop();
+    if (node->placed || node->visits == 0) continue;
+    node->placed = true;
+    order->push_back(node);
+    for (Node& child : node->children) {
+      Node* next = child.Canonical();
+      if (!next->placed && !next->children.empty()) {
+        frontier.push(Entry(next->visits, -reached++, next));
       }
     }
   }
+  qInfo() << order->size() << "nodes were visited by the profile";
 }
 
-bool GaddagMaker::Node::SameAs(const Node& other) const {
-  if (children.size() != other.children.size()) return false;
-  for (size_t i = 0; i < children.size(); ++i) {
-    if (children[i].c != other.children[i].c) return false;
-    if (children[i].terminates != other.children[i].terminates) return false;
+bool GaddagMaker::CountVisits() {
+  QFile input(profile_path);
+  if (!input.open(QIODevice::ReadOnly)) {
+    qInfo() << "could not open profile" << profile_path;
+    return false;
   }
-  for (size_t i = 0; i < children.size(); ++i) {
-    if (!children[i].SameAs(other.children[i])) return false;
+  QTextStream in(&input);
+  int racks = 0;
+  int skipped = 0;
+  while (!in.atEnd()) {
+    const QString line = in.readLine().trimmed();
+    // Anything else would encode outside counts or overflow a WordString.
+    bool valid = line.length() < static_cast<int>(WordString::maxSize);
+    for (const QChar& c : line) {
+      const QChar upper = c.toUpper();
+      if (c != '?' && (upper < 'A' || upper > 'Z')) valid = false;
+    }
+    if (!valid) {
+      ++skipped;
+      continue;
+    }
+    const WordString rack = Util::EncodeWord(line);
+    int counts[LAST_LETTER + 1] = {0};
+    for (Letter letter : rack) {
+      counts[letter]++;
+    }
+    Visit(&root, 0, counts);
+    ++racks;
   }
+  qInfo() << "replayed" << racks << "racks from" << profile_path
+          << "and skipped" << skipped << "malformed lines";
   return true;
 }
+
+// Follows the same paths the anagrammers do: in a GADDAG one letter, then the
+// separator, then letters forward; in a DAWG letters forward from the root.
+void GaddagMaker::Visit(Node* node, int depth, int* counts) {
+  node->visits++;
+  for (Node& child : node->children) {
+    Node* next = child.Canonical();
+    if (!make_dawg && depth == 1) {
+      if (child.c == DELIMITER && !next->children.empty()) {
+        Visit(next, depth + 1, counts);
+      }
+      continue;
+    }
+    if (child.c == DELIMITER || next->children.empty()) continue;
+    for (Letter tile : {child.c, static_cast<Letter>(BLANK)}) {
+      if (counts[tile] == 0) continue;
+      counts[tile]--;
+      Visit(next, depth + 1, counts);
+      counts[tile]++;
+    }
+  }
+}
+
+void GaddagMaker::Node::Annotate() {
+  if (min_length >= 0) return;
+  min_length = WordString::maxSize;
+  for (Node& child : children) {
+    // The separator takes no tile.
+    const int step = (child.c == DELIMITER) ? 0 : 1;
+    if (child.c != DELIMITER) {
+      letters |= 1 << child.c;
+    }
+    Node* next = child.Canonical();
+    int child_min = 0;
+    int child_max = 0;
+    if (!next->children.empty()) {
+      next->Annotate();
+      letters |= next->letters;
+      child_min = next->min_length;
+      child_max = next->max_length;
+    }
+    min_length = std::min(min_length, step + (child.terminates ? 0 : child_min));
+    max_length = std::max(max_length, step + child_max);
+  }
+}
+
+void GaddagMaker::Node::CountWords() {
+  if (words >= 0) return;
+  words = 0;
+  for (Node& child : children) {
+    Node* next = child.Canonical();
+    if (!next->children.empty()) {
+      next->CountWords();
+    }
+    words += child.EdgeWords(false);
+  }
+}
+
+// The words spelled through this edge: one if it terminates, plus those
+// below its node. Through the separator, only words that continue past the
+// edge's own separator child count, so a GADDAG root edge for a letter
+// numbers the words starting with that letter.
+int64_t GaddagMaker::Node::EdgeWords(bool through_separator) const {
+  const Node* next = Canonical();
+  if (through_separator) {
+    if (c == DELIMITER) return 0;
+    int64_t edge_words = terminates ? 1 : 0;
+    if (!next->children.empty() && next->children[0].c == DELIMITER) {
+      edge_words += next->children[0].EdgeWords(false);
+    }
+    return edge_words;
+  }
+  return (terminates ? 1 : 0) + (next->children.empty() ? 0 : next->words);
+}
+
+int GaddagMaker::Node::GetDepth() {
+  if (depth < 0) {
+    depth = 0;
+    for (Node& child : children) {
+      Node* next = child.Canonical();
+      if (!next->children.empty()) {
+        depth = std::max(depth, next->GetDepth());
+      }
+    }
+    if (!children.empty()) {
+      depth++;
+    }
+  }
+  return depth;
+}
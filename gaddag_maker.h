@@ -1,7 +1,12 @@
 #ifndef GADDAG_MAKER_H
 #define GADDAG_MAKER_H
 
+#include <deque>
+#include <string>
+#include <unordered_map>
+
 #include "fixed_string.h"
+#include "gaddag_file.h"
 #include "util.h"
 
 using std::map;
@@ -15,45 +20,109 @@ class GaddagMaker {
   GaddagMaker(bool make_dawg, bool flip_endian);
   bool MakeGaddag(const QString& input_path,
                   const QString& output_path);
+  // Merges several word lists into one graph. Each terminal edge records
+  // which of the inputs contain its word, input i as bit i; see
+  // GADDAG_LEXICONS.
+  bool MakeGaddag(const vector<QString>& input_paths,
+                  const QString& output_path);
+  // The lexicon hash MakeGaddag would write to the header for input_paths,
+  // without building anything.
+  bool HashLexicon(const vector<QString>& input_paths, QByteArray* hash_bytes);
+  void SetLayout(GaddagLayout layout) { this->layout = layout; }
+  // Store letter and length bounds for each node; see GADDAG_NODE_INFO.
+  void SetNodeInfo(bool node_info) { this->node_info = node_info; }
+  // Store per-edge word counts for numbering words; see GADDAG_WORD_COUNTS.
+  void SetWordCounts(bool word_counts) { this->word_counts = word_counts; }
+  // Write delta-coded edges of 1 to 4 bytes; see GADDAG_COMPRESSED. Not
+  // compatible with node info, word counts, several lexicons or flip_endian.
+  void SetCompressed(bool compressed) { this->compressed = compressed; }
+  // Racks, one per line, to replay for LAYOUT_PROFILE_GUIDED.
+  void SetProfile(const QString& rack_log_path) {
+    this->profile_path = rack_log_path;
+  }
 
  private:
+  // An edge, with the letter and termination that label it, and until it is
+  // finished the children of the node it leads to. A finished edge leads to
+  // a registered node instead, shared by every edge with the same future.
   class Node {
    public:
-    void PushWord(const WordString& word);
     int GetDepth();
-    const QByteArray& GetHash();
-    bool SameAs(const Node& other) const;
-    void Number(int* bitsets, int* indices);
-    QByteArray GetBytes(int num_child_bytes, int num_index_bytes,
+    Node* Canonical() { return (state == nullptr) ? this : state; }
+    const Node* Canonical() const {
+      return (state == nullptr) ? this : state;
+    }
+    void Annotate();
+    void CountWords();
+    int64_t EdgeWords(bool through_separator) const;
+    QByteArray GetBytes(int num_child_bytes, int num_info_bytes,
+                        int num_index_bytes, int num_count_bytes,
+                        int num_lexicon_bytes, bool through_separator,
                         bool flip_endian) const;
-    static void BinByHash(Node* node, map<QByteArray, vector<Node*>>* by_hash);
-    static void MarkDuplicates(const map<QByteArray, vector<Node*>>& by_hash);
 
-    Letter c;
-    bool terminates;
+    Letter c = DELIMITER;
+    bool terminates = false;
+    // Lexicons containing the word ending at this edge, if it terminates.
+    int lexicons = 0;
     vector<Node> children;
-    Node* duplicate;
-    int bitsets;
-    int indices;
+    // The registered node this edge leads to once finished; null for the
+    // root, registered nodes themselves and edges to leaves.
+    Node* state = nullptr;
+    // From the root, in words, or in bytes when compressed.
+    int64_t offset;
+    // Bytes per edge when compressed.
+    int width = 1;
     int depth = -1;
-    QByteArray hash;
+    int64_t visits = 0;
+    uint32_t letters = 0;
+    int min_length = -1;
+    int max_length = 0;
+    int64_t words = -1;
+    bool placed = false;
+    bool walked = false;
   };
 
-  bool GaddagizeWord(const QString& word);
-  void GaddagizeWord(const WordString &word);
-  void HashWord(const WordString& word);
+  // Each word of input_paths with the bitmask of the inputs containing it.
+  bool ReadLexicons(const vector<QString>& input_paths,
+                    map<WordString, int>* lexicons);
+  void GaddagizeWord(const WordString &word, int lexicons);
+  void HashWord(const WordString& word, int lexicons);
   void Generate();
+  // Points edge at the registered node with the same children, registering
+  // its own if there is none. Its children must all be finished.
+  void Finish(Node* edge);
   bool Write(const QString& output_path);
-  void Write(const Node& node, int num_child_bytes, int num_index_bytes,
-             QFile* ouputt);
+  bool WriteCompressed(const vector<Node*>& order, QFile* output);
+  void Order(vector<Node*>* order);
+  void OrderDepthFirst(Node* node, vector<Node*>* order);
+  void OrderBreadthFirst(vector<Node*>* order);
+  void OrderBlocked(Node* node, int height, vector<Node*>* order,
+                    vector<Node*>* frontier);
+  void OrderProfileGuided(vector<Node*>* order);
+  bool CountVisits();
+  void Visit(Node* node, int depth, int* counts);
   Node root;
-  vector<WordString> gaddag_patterns;
+  // Every distinct finished node, so the graph is minimal as it is built and
+  // only the edges of the pattern being added are ever unshared. A deque,
+  // so registered nodes never move.
+  std::deque<Node> states;
+  // Keyed by the letters, terminations, lexicons and registered nodes of
+  // their edges.
+  std::unordered_map<std::string, Node*> registry;
+  // Each with the lexicons of the word it came from.
+  vector<std::pair<WordString, int>> gaddag_patterns;
+  int num_lexicons = 1;
   union {
     char charptr[16];
     int32_t int32ptr[4];
   } hash;
   bool make_dawg;
   bool flip_endian;
+  GaddagLayout layout = LAYOUT_DEPTH_FIRST;
+  QString profile_path;
+  bool node_info = false;
+  bool word_counts = false;
+  bool compressed = false;
 };
 
 #endif // GADDAG_MAKER_H
@@ -0,0 +1,218 @@
+#include "lexicon_snapshot.h"
+
+#include <QCryptographicHash>
+#include <QDateTime>
+#include <QFile>
+#include <QFileInfo>
+#include <QtCore>
+
+#include <algorithm>
+
+#include "gaddag_maker.h"
+#include "util.h"
+
+QString LexiconSnapshot::StampPath(const QString& gaddag_path) {
+  return gaddag_path + ".sources";
+}
+
+bool LexiconSnapshot::Refresh(const std::vector<QString>& word_lists,
+                              const QString& gaddag_path,
+                              const QString& profile_path) {
+  const bool have_gaddag = QFile::exists(gaddag_path);
+  std::vector<Source> sources(word_lists.size());
+  for (size_t i = 0; i < word_lists.size(); ++i) {
+    if (!Stat(word_lists[i], &sources[i])) {
+      qInfo() << "could not find" << word_lists[i];
+      return have_gaddag;
+    }
+  }
+
+  QByteArray gaddag_hash;
+  {
+    GaddagFile gaddag;
+    if (gaddag.Open(gaddag_path)) gaddag_hash = gaddag.Hash();
+  }
+  const QString stamp_path = StampPath(gaddag_path);
+  QByteArray stamped_hash;
+  std::vector<Source> stamped;
+  if (!gaddag_hash.isEmpty() &&
+      ReadStamp(stamp_path, &stamped_hash, &stamped) &&
+      stamped_hash == gaddag_hash && stamped.size() == sources.size()) {
+    bool same_files = true;
+    for (size_t i = 0; i < sources.size(); ++i) {
+      if (sources[i].size != stamped[i].size ||
+          sources[i].modified != stamped[i].modified) {
+        same_files = false;
+      }
+    }
+    if (same_files) return true;
+
+    bool same_contents = true;
+    for (size_t i = 0; i < sources.size() && same_contents; ++i) {
+      same_contents = sources[i].size == stamped[i].size &&
+                      HashContents(word_lists[i], &sources[i]) &&
+                      sources[i].hash == stamped[i].hash;
+    }
+    if (same_contents) {
+      qInfo() << "word lists for" << gaddag_path << "are unchanged";
+      WriteStamp(stamp_path, gaddag_hash, sources);
+      return true;
+    }
+  }
+
+  // Hashed before building, so a list edited meanwhile is rebuilt next time.
+  for (size_t i = 0; i < sources.size(); ++i) {
+    if (sources[i].hash.isEmpty() &&
+        !HashContents(word_lists[i], &sources[i])) {
+      qInfo() << "could not read" << word_lists[i];
+      return have_gaddag;
+    }
+  }
+  // A gaddag from before stamps, or lists that were rewritten with the same
+  // words, only need the stamp.
+  if (!gaddag_hash.isEmpty()) {
+    QByteArray lists_hash;
+    GaddagMaker hasher(false, false);
+    if (hasher.HashLexicon(word_lists, &lists_hash) &&
+        lists_hash == gaddag_hash) {
+      qInfo() << gaddag_path << "already holds its word lists";
+      WriteStamp(stamp_path, gaddag_hash, sources);
+      return true;
+    }
+  }
+  if (!Build(word_lists, gaddag_path, profile_path)) return have_gaddag;
+  GaddagFile gaddag;
+  if (!gaddag.Open(gaddag_path)) return false;
+  WriteStamp(stamp_path, gaddag.Hash(), sources);
+  return true;
+}
+
+bool LexiconSnapshot::Stat(const QString& path, Source* source) {
+  const QFileInfo info(path);
+  if (!info.exists()) return false;
+  source->size = info.size();
+  source->modified = info.lastModified().toMSecsSinceEpoch();
+  source->hash.clear();
+  return true;
+}
+
+bool LexiconSnapshot::HashContents(const QString& path, Source* source) {
+  QFile file(path);
+  if (!file.open(QIODevice::ReadOnly)) return false;
+  QCryptographicHash hash(QCryptographicHash::Md5);
+  const qint64 size = file.size();
+  if (size > 0) {
+    uchar* data = file.map(0, size);
+    if (data == nullptr) return false;
+    hash.addData(reinterpret_cast<const char*>(data), size);
+    file.unmap(data);
+  }
+  source->hash = hash.result();
+  return true;
+}
+
+bool LexiconSnapshot::Build(const std::vector<QString>& word_lists,
+                            const QString& gaddag_path,
+                            const QString& profile_path) {
+  QElapsedTimer timer;
+  timer.start();
+  // A rebuild keeps the old gaddag's kind and layout.
+  int flags = GADDAG_NODE_INFO | GADDAG_WORD_COUNTS;
+  GaddagLayout layout = LAYOUT_DEPTH_FIRST;
+  {
+    GaddagFile old_gaddag;
+    if (old_gaddag.Open(gaddag_path)) {
+      flags = old_gaddag.Flags();
+      layout = old_gaddag.Layout();
+    }
+  }
+  if ((flags & GADDAG_COMPRESSED) && word_lists.size() > 1) {
+    qInfo() << "can't compress" << word_lists.size() << "lexicons";
+    flags &= ~GADDAG_COMPRESSED;
+  }
+  if (layout == LAYOUT_PROFILE_GUIDED && profile_path.isEmpty()) {
+    qInfo() << "no profile to lay out" << gaddag_path << "with";
+    layout = LAYOUT_DEPTH_FIRST;
+  }
+  // Written aside and moved into place, so an interrupted build leaves the
+  // old gaddag alone.
+  const QString temp_path = gaddag_path + ".tmp";
+  GaddagMaker gaddag_maker((flags & GADDAG_DAWG) != 0, false);
+  gaddag_maker.SetNodeInfo((flags & GADDAG_NODE_INFO) != 0);
+  gaddag_maker.SetWordCounts((flags & GADDAG_WORD_COUNTS) != 0);
+  gaddag_maker.SetCompressed((flags & GADDAG_COMPRESSED) != 0);
+  gaddag_maker.SetLayout(layout);
+  gaddag_maker.SetProfile(profile_path);
+  if (!gaddag_maker.MakeGaddag(word_lists, temp_path)) {
+    qInfo() << "could not build" << gaddag_path;
+    QFile::remove(temp_path);
+    return false;
+  }
+  QFile::remove(gaddag_path);
+  if (!QFile::rename(temp_path, gaddag_path)) {
+    qInfo() << "could not move" << temp_path << "to" << gaddag_path;
+    return false;
+  }
+  qInfo() << "built" << gaddag_path << "in" << timer.elapsed() << "ms";
+  return true;
+}
+
+bool LexiconSnapshot::ReadStamp(const QString& path, QByteArray* gaddag_hash,
+                                std::vector<Source>* sources) {
+  QFile input(path);
+  if (!input.open(QIODevice::ReadOnly)) return false;
+  const QByteArray data = input.readAll();
+  const char* in = data.constData();
+  if (data.size() < kLexiconStampHeaderSize ||
+      in[0] != kLexiconStampVersion) {
+    qInfo() << path << "is not a version" << kLexiconStampVersion
+            << "lexicon stamp";
+    return false;
+  }
+  const int num_sources =
+      static_cast<unsigned char>(in[kLexiconStampCountOffset]);
+  if (data.size() !=
+      kLexiconStampHeaderSize + num_sources * kLexiconStampEntrySize) {
+    qInfo() << path << "is truncated";
+    return false;
+  }
+  *gaddag_hash = QByteArray(in + kLexiconStampHashOffset, kGaddagHashSize);
+  in += kLexiconStampHeaderSize;
+  sources->clear();
+  for (int i = 0; i < num_sources; ++i) {
+    sources->push_back({static_cast<qint64>(Util::GetLittleEndian(in, 8)),
+                        static_cast<qint64>(Util::GetLittleEndian(in + 8, 8)),
+                        QByteArray(in + 16, 16)});
+    in += kLexiconStampEntrySize;
+  }
+  return true;
+}
+
+bool LexiconSnapshot::WriteStamp(const QString& path,
+                                 const QByteArray& gaddag_hash,
+                                 const std::vector<Source>& sources) {
+  QByteArray data(kLexiconStampHeaderSize +
+                      sources.size() * kLexiconStampEntrySize,
+                  0);
+  char* out = data.data();
+  out[0] = kLexiconStampVersion;
+  memcpy(out + kLexiconStampHashOffset, gaddag_hash.constData(),
+         std::min<int>(gaddag_hash.size(), kGaddagHashSize));
+  out[kLexiconStampCountOffset] = static_cast<char>(sources.size());
+  out += kLexiconStampHeaderSize;
+  for (const Source& source : sources) {
+    Util::PutLittleEndian(source.size, 8, out);
+    Util::PutLittleEndian(source.modified, 8, out + 8);
+    memcpy(out + 16, source.hash.constData(),
+           std::min<int>(source.hash.size(), 16));
+    out += kLexiconStampEntrySize;
+  }
+
+  QFile output(path);
+  if (!output.open(QIODevice::WriteOnly) ||
+      output.write(data) != data.size()) {
+    qInfo() << "could not write" << path;
+    return false;
+  }
+  return true;
+}
@@ -0,0 +1,68 @@
+#ifndef LEXICON_SNAPSHOT_H
+#define LEXICON_SNAPSHOT_H
+
+#include <QByteArray>
+#include <QString>
+
+#include <vector>
+
+#include "gaddag_file.h"
+
+constexpr int kLexiconStampVersion = 1;
+constexpr int kLexiconStampHeaderSize = 24;
+constexpr int kLexiconStampHashOffset = 1;
+constexpr int kLexiconStampCountOffset = 17;
+// Size, modification time, content hash.
+constexpr int kLexiconStampEntrySize = 8 + 8 + 16;
+
+// Keeps a gaddag built from text word lists current, so a launch maps the
+// compiled lexicon instead of parsing the lists.
+//
+// Next to the gaddag is a stamp recording what it was built from:
+//
+//   byte 0: kLexiconStampVersion
+//   bytes 1-16: the gaddag's lexicon hash
+//   byte 17: number of word lists
+//   from byte 24, per list in lexicon order: size, modification time in ms
+//   since the epoch (8 bytes each, little-endian), then the MD5 of its
+//   contents (16 bytes)
+//
+// If every list still has its recorded size and modification time, the
+// gaddag is current without reading any list. If only the times differ,
+// the lists are hashed, and if their contents are unchanged only the stamp
+// is rewritten. Otherwise, including when there is no stamp yet, the lists'
+// words are hashed the way GaddagMaker hashes them, and if they match the
+// gaddag's lexicon hash only the stamp is written. Anything else rebuilds
+// the gaddag, with the flags and layout of the one it replaces.
+class LexiconSnapshot {
+ public:
+  // The stamp kept for the gaddag at gaddag_path.
+  static QString StampPath(const QString& gaddag_path);
+
+  // Makes sure the gaddag at gaddag_path was built from word_lists, in
+  // lexicon order, rebuilding it if not. If the lists cannot be read, an
+  // existing gaddag is kept as it is. Returns false if there is still no
+  // gaddag. A profile-guided gaddag is rebuilt from profile_path, or in
+  // preorder if there is none.
+  static bool Refresh(const std::vector<QString>& word_lists,
+                      const QString& gaddag_path,
+                      const QString& profile_path = QString());
+
+ private:
+  struct Source {
+    qint64 size;
+    qint64 modified;
+    QByteArray hash;
+  };
+
+  static bool Stat(const QString& path, Source* source);
+  static bool HashContents(const QString& path, Source* source);
+  static bool Build(const std::vector<QString>& word_lists,
+                    const QString& gaddag_path, const QString& profile_path);
+  static bool ReadStamp(const QString& path, QByteArray* gaddag_hash,
+                        std::vector<Source>* sources);
+  static bool WriteStamp(const QString& path, const QByteArray& gaddag_hash,
+                         const std::vector<Source>& sources);
+};
+
+#endif  // LEXICON_SNAPSHOT_H
@@ -1,7 +1,19 @@
 #include "wordmonger.h"
 #include <QApplication>
 
+#include <cstring>
+#include <vector>
+
 int main(int argc, char *argv[]) {
+  // "--benchmark FILE..." compares gaddag files and exits without a window.
+  if (argc > 1 && strcmp(argv[1], "--benchmark") == 0) {
+    std::vector<QString> paths;
+    for (int i = 2; i < argc; ++i) {
+      paths.push_back(QString::fromLocal8Bit(argv[i]));
+    }
+    Wordmonger::BenchmarkGaddags(paths);
+    return 0;
+  }
   QApplication a(argc, argv);
   Wordmonger w(nullptr);
   w.show();
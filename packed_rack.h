@@ -0,0 +1,102 @@
+#ifndef PACKED_RACK_H
+#define PACKED_RACK_H
+
+#include <cstdint>
+
+#include "util.h"
+
+// A multiset of tiles as 27 four-bit counters in one 128-bit value, the
+// blank's in the low nibble and each letter's at 4 * letter. Taking or
+// returning a tile is one add, "are any left" is one compare and "is this a
+// sub-multiset of that" is a few word-wide operations on both halves, so a
+// traversal carries its whole rack in two registers.
+//
+// No letter may be held more than 15 times.
+class PackedRack {
+ public:
+  using Value = unsigned __int128;
+
+  PackedRack() : counts_(0) {}
+
+  template <typename String>
+  explicit PackedRack(const String& tiles) : counts_(0) {
+    for (Letter tile : tiles) {
+      Add(tile);
+    }
+  }
+
+  static PackedRack FromValue(Value value) {
+    PackedRack rack;
+    rack.counts_ = value;
+    return rack;
+  }
+  Value ToValue() const { return counts_; }
+
+  int Count(Letter tile) const { return (counts_ >> (4 * tile)) & 0xF; }
+  bool Has(Letter tile) const { return Count(tile) != 0; }
+  void Add(Letter tile) { counts_ += Unit(tile); }
+  void Remove(Letter tile) { counts_ -= Unit(tile); }
+
+  bool IsEmpty() const { return counts_ == 0; }
+  bool operator==(const PackedRack& other) const {
+    return counts_ == other.counts_;
+  }
+  bool operator!=(const PackedRack& other) const {
+    return counts_ != other.counts_;
+  }
+
+  // Whether every tile of other is also in this rack. Each nibble is spread
+  // into its own byte with a guard bit above it, so the subtraction borrows
+  // out of a byte's guard exactly when other has more of that tile.
+  bool Contains(const PackedRack& other) const {
+    const Value kLowNibbles = Repeat(0x0F);
+    const Value kGuards = Repeat(0x10);
+    const Value mine_even = (counts_ & kLowNibbles) | kGuards;
+    const Value mine_odd = ((counts_ >> 4) & kLowNibbles) | kGuards;
+    const Value theirs_even = other.counts_ & kLowNibbles;
+    const Value theirs_odd = (other.counts_ >> 4) & kLowNibbles;
+    return ((mine_even - theirs_even) & (mine_odd - theirs_odd) & kGuards) ==
+           kGuards;
+  }
+
+  int NumTiles() const {
+    const Value kLowNibbles = Repeat(0x0F);
+    // At most 30 per byte, so eight bytes sum without overflow.
+    const Value bytes = (counts_ & kLowNibbles) + ((counts_ >> 4) & kLowNibbles);
+    const uint64_t kOnes = 0x0101010101010101ULL;
+    return ((static_cast<uint64_t>(bytes) * kOnes) >> 56) +
+           ((static_cast<uint64_t>(bytes >> 64) * kOnes) >> 56);
+  }
+
+  // 1 << letter for each letter held, in the form the gaddag readers take
+  // rack_bits. Blanks are left out.
+  uint32_t LetterBits() const {
+    uint32_t bits = 0;
+    for (Letter letter = FIRST_LETTER; letter <= LAST_LETTER; ++letter) {
+      if (Has(letter)) bits |= 1 << letter;
+    }
+    return bits;
+  }
+
+  // The tiles in letter order, blanks first.
+  WordString ToWord() const {
+    WordString word;
+    for (Letter tile = BLANK; tile <= LAST_LETTER; ++tile) {
+      for (int i = Count(tile); i > 0; --i) {
+        word.push_back(tile);
+      }
+    }
+    return word;
+  }
+
+ private:
+  static Value Unit(Letter tile) { return static_cast<Value>(1) << (4 * tile); }
+  static Value Repeat(uint8_t byte) {
+    const uint64_t half = byte * 0x0101010101010101ULL;
+    return (static_cast<Value>(half) << 64) | half;
+  }
+
+  Value counts_;
+};
+
+#endif  // PACKED_RACK_H
@@ -0,0 +1,127 @@
+#include "probability_index.h"
+
+#include <QtConcurrent>
+#include <QtCore>
+
+#include <algorithm>
+
+namespace {
+
+// PackedRack holds at most 15 of a tile.
+constexpr int kMaxCount = 15;
+
+struct Binomials {
+  Binomials() {
+    for (int n = 0; n <= kMaxCount; ++n) {
+      choose[n][0] = 1;
+      for (int k = 1; k <= kMaxCount; ++k) {
+        choose[n][k] = (n == 0) ? 0 : choose[n - 1][k - 1] + choose[n - 1][k];
+      }
+    }
+  }
+  uint64_t choose[kMaxCount + 1][kMaxCount + 1];
+};
+
+uint64_t Choose(int n, int k) {
+  static const Binomials binomials;
+  if (k < 0 || k > n) return 0;
+  return binomials.choose[n][k];
+}
+
+}  // namespace
+
+ProbabilityIndex::ProbabilityIndex() {}
+
+// Blanks fill in for letters the draw is short of. Multiplying, letter by
+// letter, the polynomials whose jth coefficient is the number of ways to
+// draw the letter's count minus j real tiles gives, as coefficient k, the
+// number of ways to draw the real tiles of a draw with k blanks.
+uint64_t ProbabilityIndex::Combinations(const PackedRack& letters,
+                                        const PackedRack& bag) {
+  const int blanks = bag.Count(BLANK);
+  std::vector<uint64_t> ways(blanks + 1, 0);
+  ways[0] = 1;
+  std::vector<uint64_t> product(blanks + 1);
+  for (Letter letter = FIRST_LETTER; letter <= LAST_LETTER; ++letter) {
+    const int count = letters.Count(letter);
+    if (count == 0) continue;
+    std::fill(product.begin(), product.end(), 0);
+    for (int used = 0; used <= blanks; ++used) {
+      if (ways[used] == 0) continue;
+      for (int j = 0; j <= count && used + j <= blanks; ++j) {
+        product[used + j] += ways[used] * Choose(bag.Count(letter), count - j);
+      }
+    }
+    ways.swap(product);
+  }
+  uint64_t total = 0;
+  for (int used = 0; used <= blanks; ++used) {
+    total += Choose(blanks, used) * ways[used];
+  }
+  return total;
+}
+
+void ProbabilityIndex::Build(const AlphagramIndex& index, const Bag& bag) {
+  const int num_alphagrams = index.NumAlphagrams();
+  combinations_.assign(num_alphagrams, 0);
+  ranks_.assign(num_alphagrams, 0);
+  by_rank_.assign(num_alphagrams, 0);
+  length_starts_.assign(WordString::maxSize + 2, 0);
+  for (size_t length = 0; length < length_starts_.size(); ++length) {
+    length_starts_[length] = index.LengthBegin(length);
+  }
+
+  // Each length is its own slice of every array, so the tasks never touch
+  // the same element.
+  const PackedRack tiles(bag);
+  std::vector<std::pair<int, int>> ranges;
+  for (int length = 0; length <= static_cast<int>(WordString::maxSize);
+       ++length) {
+    const int begin = index.LengthBegin(length);
+    const int end = index.LengthEnd(length);
+    if (begin != end) ranges.push_back({begin, end});
+  }
+  QtConcurrent::blockingMap(ranges, [&](const std::pair<int, int>& range) {
+    BuildLength(index, tiles, range.first, range.second);
+  });
+  qInfo() << "ranked" << num_alphagrams << "alphagrams by probability";
+}
+
+void ProbabilityIndex::BuildLength(const AlphagramIndex& index,
+                                   const PackedRack& bag, int begin, int end) {
+  for (int alphagram = begin; alphagram < end; ++alphagram) {
+    by_rank_[alphagram] = alphagram;
+    combinations_[alphagram] =
+        Combinations(PackedRack::FromValue(index.At(alphagram).key), bag);
+  }
+  std::sort(by_rank_.begin() + begin, by_rank_.begin() + end,
+            [this, &index](int a, int b) {
+              if (combinations_[a] != combinations_[b]) {
+                return combinations_[a] > combinations_[b];
+              }
+              return index.At(a).key < index.At(b).key;
+            });
+  for (int i = begin; i < end; ++i) {
+    ranks_[by_rank_[i]] = i - begin + 1;
+  }
+}
+
+int ProbabilityIndex::NumRanked(int length) const {
+  if (length < 0 || length + 1 >= static_cast<int>(length_starts_.size())) {
+    return 0;
+  }
+  return length_starts_[length + 1] - length_starts_[length];
+}
+
+int ProbabilityIndex::AtRank(int length, int rank) const {
+  return by_rank_[length_starts_[length] + rank - 1];
+}
+
+void ProbabilityIndex::Ranked(int length, int first_rank, int last_rank,
+                              std::vector<int>* alphagrams) const {
+  first_rank = std::max(first_rank, 1);
+  last_rank = std::min(last_rank, NumRanked(length));
+  for (int rank = first_rank; rank <= last_rank; ++rank) {
+    alphagrams->push_back(AtRank(length, rank));
+  }
+}
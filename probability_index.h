@@ -0,0 +1,62 @@
+#ifndef PROBABILITY_INDEX_H
+#define PROBABILITY_INDEX_H
+
+#include <cstdint>
+#include <vector>
+
+#include "alphagram_index.h"
+#include "packed_rack.h"
+#include "util.h"
+
+// How likely each alphagram is to be drawn from a bag, and its rank among
+// the alphagrams of its length, most probable first. Both are computed once
+// per lexicon, so probability-ordered quizzes and rank ranges like "the
+// 1000 most probable sevens" are array lookups.
+//
+// Probability is counted the usual way, as the number of distinct sets of
+// tiles in the bag that spell the alphagram, blanks standing in for any
+// letter. Alphagrams with the same count are ranked by key, so ranks are
+// distinct and stable across runs.
+class ProbabilityIndex {
+ public:
+  ProbabilityIndex();
+
+  // Ranks every alphagram in index, one task per length on Qt's global thread
+  // pool.
+  void Build(const AlphagramIndex& index, const Bag& bag);
+  bool IsEmpty() const { return combinations_.empty(); }
+
+  // The number of ways to draw letters from bag, which may hold blanks.
+  static uint64_t Combinations(const PackedRack& letters,
+                               const PackedRack& bag);
+
+  // By position in the alphagram index.
+  uint64_t Combinations(int alphagram) const {
+    return combinations_[alphagram];
+  }
+  // From 1, among alphagrams of the same length.
+  int Rank(int alphagram) const { return ranks_[alphagram]; }
+
+  int NumRanked(int length) const;
+  // The alphagram of length letters with the given rank.
+  int AtRank(int length, int rank) const;
+  // The alphagrams of length letters ranked first_rank to last_rank, in rank
+  // order, clipped to those there are.
+  void Ranked(int length, int first_rank, int last_rank,
+              std::vector<int>* alphagrams) const;
+
+ private:
+  // Fills in alphagrams [begin, end), which all have the same length.
+  void BuildLength(const AlphagramIndex& index, const PackedRack& bag,
+                   int begin, int end);
+
+  std::vector<uint64_t> combinations_;
+  std::vector<int> ranks_;
+  // Laid out like the alphagram index, but each length's alphagrams sorted
+  // by rank.
+  std::vector<int> by_rank_;
+  // by_rank_ of length n start at length_starts_[n].
+  std::vector<int> length_starts_;
+};
+
+#endif  // PROBABILITY_INDEX_H
@@ -0,0 +1,80 @@
+#ifndef RANDOM_H
+#define RANDOM_H
+
+#include <chrono>
+#include <cstdint>
+#include <random>
+#include <utility>
+
+// A small, fast generator (xoshiro256**) for drawing tiles and sampling
+// quizzes. Unlike rand() it has no shared state: each thread or task owns
+// its own Random, and the same seed always gives the same sequence on every
+// platform, so a quiz can be regenerated from its seed.
+class Random {
+ public:
+  explicit Random(uint64_t seed) { Seed(seed); }
+
+  // The state is filled from seed with splitmix64, as the xoshiro authors
+  // recommend, so nearby seeds give unrelated sequences.
+  void Seed(uint64_t seed) {
+    for (uint64_t& word : state_) {
+      seed += 0x9E3779B97F4A7C15ULL;
+      uint64_t z = seed;
+      z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+      z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+      word = z ^ (z >> 31);
+    }
+  }
+
+  uint64_t Next() {
+    const uint64_t result = Rotate(state_[1] * 5, 7) * 9;
+    const uint64_t t = state_[1] << 17;
+    state_[2] ^= state_[0];
+    state_[3] ^= state_[1];
+    state_[1] ^= state_[2];
+    state_[0] ^= state_[3];
+    state_[2] ^= t;
+    state_[3] = Rotate(state_[3], 45);
+    return result;
+  }
+
+  // Uniform in [0, n), without the modulo bias of rand() % n: Lemire's
+  // multiply-and-shift, redrawing in the rare case the low half of the
+  // product lands in the biased sliver.
+  uint32_t Uniform(uint32_t n) {
+    uint64_t product = (Next() >> 32) * n;
+    uint32_t low = static_cast<uint32_t>(product);
+    if (low < n) {
+      const uint32_t threshold = -n % n;
+      while (low < threshold) {
+        product = (Next() >> 32) * n;
+        low = static_cast<uint32_t>(product);
+      }
+    }
+    return product >> 32;
+  }
+
+  // Fisher-Yates.
+  template <typename Iterator>
+  void Shuffle(Iterator begin, Iterator end) {
+    for (auto i = end - begin - 1; i > 0; --i) {
+      std::swap(begin[i], begin[Uniform(i + 1)]);
+    }
+  }
+
+  // For call sites that want a different sequence each run.
+  static uint64_t TimeSeed() {
+    const uint64_t now =
+        std::chrono::system_clock::now().time_since_epoch().count();
+    return now ^ (static_cast<uint64_t>(std::random_device()()) << 32);
+  }
+
+ private:
+  static uint64_t Rotate(uint64_t x, int k) {
+    return (x << k) | (x >> (64 - k));
+  }
+
+  uint64_t state_[4];
+};
+
+#endif  // RANDOM_H
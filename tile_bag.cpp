@@ -0,0 +1,38 @@
+#include "tile_bag.h"
+
+Letter TileBag::Draw(Random* random) {
+  int position = random->Uniform(num_tiles_);
+  Letter tile = BLANK;
+  while (position >= tiles_.Count(tile)) {
+    position -= tiles_.Count(tile);
+    ++tile;
+  }
+  tiles_.Remove(tile);
+  --num_tiles_;
+  return tile;
+}
+
+WordString TileBag::RandomRack(int size, Random* random) const {
+  TileBag bag = *this;
+  WordString rack;
+  for (int i = 0; i < size; ++i) {
+    rack += bag.Draw(random);
+  }
+  return rack;
+}
+
+WordString TileBag::BlankRack(int blanks, int size, Random* random) const {
+  TileBag letters = *this;
+  while (letters.tiles_.Has(BLANK)) {
+    letters.tiles_.Remove(BLANK);
+    --letters.num_tiles_;
+  }
+  WordString rack;
+  for (int i = 0; i < blanks; ++i) {
+    rack += BLANK;
+  }
+  for (int i = blanks; i < size; ++i) {
+    rack += letters.Draw(random);
+  }
+  return rack;
+}
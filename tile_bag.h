@@ -0,0 +1,40 @@
+#ifndef TILE_BAG_H
+#define TILE_BAG_H
+
+#include "packed_rack.h"
+#include "random.h"
+#include "util.h"
+
+// The tiles left in a bag as per-letter counts. Copying one is two words,
+// and drawing a tile picks a uniformly random position among the tiles left
+// and walks the 27 counts to it, so every draw is exact and the cost does
+// not grow as the bag empties.
+//
+// Draws take the caller's Random; a TileBag is otherwise a plain value, so
+// const ones can be shared between threads.
+class TileBag {
+ public:
+  TileBag() : num_tiles_(0) {}
+  explicit TileBag(const Bag& bag) : tiles_(bag), num_tiles_(bag.size()) {}
+
+  static TileBag Scrabble() { return TileBag(Util::ScrabbleBag()); }
+
+  int NumTiles() const { return num_tiles_; }
+  int Count(Letter tile) const { return tiles_.Count(tile); }
+  const PackedRack& Tiles() const { return tiles_; }
+
+  // Takes out a uniformly random tile. The bag must not be empty.
+  Letter Draw(Random* random);
+
+  // size tiles drawn from a copy of this bag.
+  WordString RandomRack(int size, Random* random) const;
+  // blanks blanks, then size - blanks letters drawn from a copy of this bag
+  // with its own blanks taken out.
+  WordString BlankRack(int blanks, int size, Random* random) const;
+
+ private:
+  PackedRack tiles_;
+  int num_tiles_;
+};
+
+#endif  // TILE_BAG_H
@@ -1,46 +1,15 @@
 #include "util.h"
 
+#include <set>
+
+#include "random.h"
+
 Bag Util::ScrabbleBag() {
   QString bag("??AAAAAAAAABBCCDDDDEEEEEEEEEEEEFFGGGHHIIIIIIIIIJKLLLLMMNNNNNNOOOOOOOOPPQRRRRRRSSSSTTTTTTUUUUVVWWXYYZ");
   qInfo() << "bag.length():" << bag.length();
   return EncodeBag(bag);
 }
 
-WordString Util::BlankRack(const Bag& bag, int blanks, int size) {
-  Bag bag_copy = bag;
-  WordString rack;
-  for (int i = 0; i < blanks; ++i) {
-    rack += BLANK;
-  }
-  for (int i = blanks; i < size;) {
-    const int letter_pos = rand() % bag.size();
-    const Letter c = bag_copy[letter_pos];
-    if (c >= FIRST_LETTER && c <= LAST_LETTER) {
-      rack += c;
-      i++;
-    } else {
-      bag_copy[letter_pos] = NOT_A_LETTER;
-    }
-  }
-  return rack;
-}
-
-WordString Util::RandomRack(const Bag& bag, int size) {
-  Bag bag_copy = bag;
-  WordString rack;
-  for (int i = 0; i < size;) {
-    const int letter_pos = rand() % bag.size();
-    const Letter c = bag_copy[letter_pos];
-    if (c <= LAST_LETTER) {
-      rack += c;
-      i++;
-    } else {
-      bag_copy[letter_pos] = NOT_A_LETTER;
-    }
-  }
-  return rack;
-}
-
 WordString Util::EncodeWord(const QString& word) {
   // qInfo() << "EncodeWord(" << word << ")";
   WordString word_string;
@@ -107,3 +76,48 @@ QString Util::DecodeCounts(int* counts) {
   }
   return word;
 }
+
+void Util::SampleRanges(const std::vector<std::pair<int, int>>& ranges,
+                        int count, Random* random, std::vector<int>* chosen) {
+  int total = 0;
+  for (const auto& range : ranges) {
+    total += range.second;
+  }
+  count = std::min(count, total);
+
+  // Floyd's algorithm: count distinct positions in [0, total).
+  std::set<int> positions;
+  for (int j = total - count; j < total; ++j) {
+    const int position = random->Uniform(j + 1);
+    if (!positions.insert(position).second) {
+      positions.insert(j);
+    }
+  }
+  std::vector<int> sample;
+  for (int position : positions) {
+    for (const auto& range : ranges) {
+      if (position < range.second) {
+        sample.push_back(range.first + position);
+        break;
+      }
+      position -= range.second;
+    }
+  }
+  random->Shuffle(sample.begin(), sample.end());
+  chosen->insert(chosen->end(), sample.begin(), sample.end());
+}
+
+void Util::PutLittleEndian(uint64_t value, int num_bytes, char* out) {
+  for (int i = 0; i < num_bytes; ++i) {
+    out[i] = static_cast<char>(value >> (8 * i));
+  }
+}
+
+uint64_t Util::GetLittleEndian(const char* in, int num_bytes) {
+  uint64_t value = 0;
+  for (int i = 0; i < num_bytes; ++i) {
+    const uint64_t byte = static_cast<unsigned char>(in[i]);
+    value |= byte << (8 * i);
+  }
+  return value;
+}
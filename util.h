@@ -3,9 +3,14 @@
 
 #include <QtCore>
 
+#include <utility>
+#include <vector>
+
 #include "fixed_string.h"
 #include "long_fixed_string.h"
 
+class Random;
+
 using Bag = LongFixedString;
 using Letter = unsigned char;
 using WordString = FixedString;
@@ -19,8 +24,6 @@ using WordString = FixedString;
 class Util {
  public:
   static Bag ScrabbleBag();
-  static WordString BlankRack(const Bag& bag, int blanks, int size);
-  static WordString RandomRack(const Bag& bag, int size);
 
   static WordString EncodeWord(const QString& word);
   static Bag EncodeBag(const QString& word);
@@ -32,6 +35,16 @@ class Util {
 
   static QString DecodeBits(int32_t bits);
   static QString DecodeCounts(int* counts);
+
+  // Appends count distinct indices, or as many as there are, chosen
+  // uniformly from ranges of (first index, size) and in random order.
+  static void SampleRanges(const std::vector<std::pair<int, int>>& ranges,
+                           int count, Random* random,
+                           std::vector<int>* chosen);
+
+  // The low num_bytes bytes of value, least significant first, and back.
+  static void PutLittleEndian(uint64_t value, int num_bytes, char* out);
+  static uint64_t GetLittleEndian(const char* in, int num_bytes);
 };
 
 
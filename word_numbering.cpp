@@ -0,0 +1,130 @@
+#include "word_numbering.h"
+
+#include "compressed_gaddag.h"
+
+template <typename GaddagType>
+const unsigned char* WordNumbering<GaddagType>::Forward(
+    const unsigned char* first_edge) const {
+  const unsigned char* node = gaddag_.FollowIndex(first_edge);
+  if (node == nullptr || is_dawg_) return node;
+  const unsigned char* separator = gaddag_.ChangeDirection(node);
+  if (separator == nullptr) return nullptr;
+  return gaddag_.FollowIndex(separator);
+}
+
+template <typename GaddagType>
+int WordNumbering<GaddagType>::WordId(const WordString& word) const {
+  if (num_words_ == 0 || word.empty()) return -1;
+  const unsigned char* node = gaddag_.Root();
+  int id = 0;
+  for (size_t i = 0; i < word.length(); ++i) {
+    const Letter letter = word[i];
+    if (letter < FIRST_LETTER || letter > LAST_LETTER) return -1;
+    if (!gaddag_.HasChild(node, letter)) return -1;
+    const unsigned char* edge = gaddag_.Child(node, letter);
+    id += gaddag_.WordsBefore(node, edge);
+    const bool terminates = gaddag_.CompletesWord(edge);
+    if (i + 1 == word.length()) {
+      return terminates ? id : -1;
+    }
+    // The word ending here sorts before everything that extends it.
+    if (terminates) ++id;
+    node = (i == 0) ? Forward(edge) : gaddag_.FollowIndex(edge);
+    if (node == nullptr) return -1;
+  }
+  return -1;
+}
+
+template <typename GaddagType>
+WordString WordNumbering<GaddagType>::Word(int id) const {
+  WordString word;
+  if (id < 0 || id >= num_words_) return word;
+  const unsigned char* node = gaddag_.Root();
+  while (node != nullptr) {
+    // Take the last edge that starts at or before id. Every edge spells at
+    // least one word, so the counts strictly increase along the node.
+    Letter min_letter = FIRST_LETTER;
+    int child_index = gaddag_.HasChild(node, GADDAG_SEPARATOR) ? 1 : 0;
+    const unsigned char* edge = nullptr;
+    Letter edge_letter = 0;
+    uint32_t edge_words_before = 0;
+    for (;;) {
+      Letter letter;
+      const unsigned char* child =
+          gaddag_.NextChild(node, min_letter, &child_index, &letter);
+      if (child == nullptr) break;
+      const uint32_t words_before = gaddag_.WordsBefore(node, child);
+      if (words_before > static_cast<uint32_t>(id)) break;
+      edge = child;
+      edge_letter = letter;
+      edge_words_before = words_before;
+      min_letter = letter + 1;
+      ++child_index;
+    }
+    if (edge == nullptr) break;
+    id -= edge_words_before;
+    word.push_back(edge_letter);
+    if (gaddag_.CompletesWord(edge)) {
+      if (id == 0) return word;
+      --id;
+    }
+    node = (word.length() == 1) ? Forward(edge) : gaddag_.FollowIndex(edge);
+  }
+  qInfo() << "word counts are inconsistent with the graph";
+  return WordString();
+}
+
+template <typename GaddagType>
+int WordNumbering<GaddagType>::Lexicons(const WordString& word) const {
+  const unsigned char* node = gaddag_.Root();
+  for (size_t i = 0; i < word.length(); ++i) {
+    const Letter letter = word[i];
+    if (letter < FIRST_LETTER || letter > LAST_LETTER) return 0;
+    if (node == nullptr || !gaddag_.HasChild(node, letter)) return 0;
+    const unsigned char* edge = gaddag_.Child(node, letter);
+    if (i + 1 == word.length()) {
+      return gaddag_.CompletesWord(edge) ? gaddag_.Lexicons(node, edge) : 0;
+    }
+    node = (i == 0) ? Forward(edge) : gaddag_.FollowIndex(edge);
+  }
+  return 0;
+}
+
+template <typename GaddagType>
+void WordNumbering<GaddagType>::Words(std::vector<WordString>* words) const {
+  WordString prefix;
+  Spell(gaddag_.Root(), &prefix, words);
+}
+
+// The same walk as Word(), taking every edge: children in letter order, and
+// a word before the words that extend it.
+template <typename GaddagType>
+void WordNumbering<GaddagType>::Spell(const unsigned char* node,
+                                      WordString* prefix,
+                                      std::vector<WordString>* words) const {
+  Letter min_letter = FIRST_LETTER;
+  int child_index = gaddag_.HasChild(node, GADDAG_SEPARATOR) ? 1 : 0;
+  for (;;) {
+    Letter letter;
+    const unsigned char* edge =
+        gaddag_.NextChild(node, min_letter, &child_index, &letter);
+    if (edge == nullptr) break;
+    prefix->push_back(letter);
+    if (gaddag_.CompletesWord(edge)) words->push_back(*prefix);
+    const unsigned char* next =
+        (prefix->length() == 1) ? Forward(edge) : gaddag_.FollowIndex(edge);
+    if (next != nullptr) Spell(next, prefix, words);
+    prefix->pop_back();
+    min_letter = letter + 1;
+    ++child_index;
+  }
+}
+
+// Every layout GaddagFile accepts.
+template class WordNumbering<Gaddag<4, 1>>;
+template class WordNumbering<Gaddag<4, 2>>;
+template class WordNumbering<Gaddag<4, 3>>;
+template class WordNumbering<Gaddag<4, 4>>;
+template class WordNumbering<AlignedGaddag>;
+template class WordNumbering<AnnotatedGaddag>;
+template class WordNumbering<CompressedGaddag>;
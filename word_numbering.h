@@ -0,0 +1,48 @@
+#ifndef WORD_NUMBERING_H
+#define WORD_NUMBERING_H
+
+#include <vector>
+
+#include "gaddag.h"
+#include "util.h"
+
+// Maps words to dense IDs and back using the per-edge word counts of a file
+// written with GADDAG_WORD_COUNTS. IDs run from 0 to NumWords() - 1 in
+// alphabetical order, and both directions take one step per letter.
+template <typename GaddagType>
+class WordNumbering {
+ public:
+  WordNumbering(const char* data, int flags, int num_words)
+      : gaddag_(data, flags),
+        is_dawg_((flags & GADDAG_DAWG) != 0),
+        num_words_(num_words) {}
+
+  int NumWords() const { return num_words_; }
+
+  // Returns -1 if word is not in the lexicon.
+  int WordId(const WordString& word) const;
+
+  // Returns an empty word if id is out of range.
+  WordString Word(int id) const;
+
+  // The bitmask of lexicons containing word, zero if none do. Doesn't need
+  // word counts.
+  int Lexicons(const WordString& word) const;
+
+  // Appends every word in ID order by walking the graph, so it works on
+  // files without word counts too.
+  void Words(std::vector<WordString>* words) const;
+
+ private:
+  // The node the rest of a word starting at root edge first_edge is spelled
+  // forward from; in a GADDAG that's past the first letter's separator.
+  const unsigned char* Forward(const unsigned char* first_edge) const;
+  void Spell(const unsigned char* node, WordString* prefix,
+             std::vector<WordString>* words) const;
+
+  const GaddagType gaddag_;
+  const bool is_dawg_;
+  const int num_words_;
+};
+
+#endif  // WORD_NUMBERING_H
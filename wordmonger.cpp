@@ -1,16 +1,24 @@
 #include <QFile>
+#include <QFileInfo>
 #include <QGridLayout>
+#include <QProgressBar>
+#include <QtConcurrent>
 #include <QtGui>
 #include <QtWidgets>
 
-#include "gaddag.h"
-#include "gaddag_maker.h"
+#include "anagrammer.h"
+#include "blank_rack_picker.h"
+#include "lexicon_snapshot.h"
 #include "util.h"
 #include "wordmonger.h"
 
 Wordmonger* Wordmonger::self = 0;
 Wordmonger* Wordmonger::get() { return self; }
-Wordmonger::~Wordmonger() {}
+Wordmonger::~Wordmonger() {
+  // Prefetches hold this; cancelled, they finish quickly.
+  ++quiz_generation;
+  QThreadPool::globalInstance()->waitForDone();
+}
 
 Wordmonger::Wordmonger(QWidget* parent) : QMainWindow(parent) {
   self = this;
@@ -21,19 +29,21 @@ Wordmonger::Wordmonger(QWidget* parent) : QMainWindow(parent) {
   num_rows = 9;
   num_cols = 5;
   max_blank_words_per_rack = 5;
+  // To replay quizzes from a logged seed.
+  bool seeded = false;
+  quiz_seed = qgetenv("WORDMONGER_SEED").toULongLong(&seeded);
+  if (seeded) {
+    qInfo() << "seeded from WORDMONGER_SEED";
+  } else {
+    quiz_seed = Random::TimeSeed();
+  }
   font_name = "Optima";
   font_weight = QFont::Black;
 
   CreateMenus();
-  LoadDictionaries();
   CreateCentralWidgetAndLayout();
   CreateQuizChoiceWidgets();
-  //CreateGridQuizWidgets();
-
-  //ChooseWords();
-  //DrawRacks();
-  //AddQuestions();
-  //StartTimer();
+  LoadDictionaries();
 }
 
 void Wordmonger::CreateMenus() {
@@ -46,7 +56,12 @@ void Wordmonger::CreateMenus() {
   fullscreen_action->setShortcut(tr("Ctrl+F"));
   connect(fullscreen_action, SIGNAL(triggered()), this,
           SLOT(ToggleFullscreenSlot()));
+  start_action = new QAction(tr("&Start"), this);
+  start_action->setShortcut(tr("Ctrl+Return"));
+  connect(start_action, SIGNAL(triggered()), this, SLOT(StartQuizSlot()));
+
   quiz_menu = menu_bar->addMenu(tr("&Quiz"));
+  quiz_menu->addAction(start_action);
   quiz_menu->addAction(fullscreen_action);
   quiz_menu->addAction(pause_action);
 
@@ -73,52 +88,131 @@ namespace {
     }
     return vowels + consonants;
   }
-}  // namespace
 
-void Wordmonger::DrawRacks() {
-  srand(time(nullptr));
-  const Bag bag = Util::ScrabbleBag();
-  vector<int> column_starts;
-  std::set<QString> previous_answers;
-  for (size_t col = 0; col < num_cols; ++col) {
-    qInfo() << "col:" << col;
-    column_starts.push_back(questions_and_answers.size());
-    for (size_t row = 0; row < num_rows;) {
-      qInfo() << "row: " << row;
-      const size_t max_words_in_rack =
-          std::min(num_rows - row, max_blank_words_per_rack);
-      qInfo() << "max_words_in_rack:" << max_words_in_rack;
-      const WordString rack = Util::BlankRack(bag, 1, 7);
-      qInfo() << "rack:" << Util::DecodeWord(rack);
-      std::set<WordString> words = GetAnagrams(rack, true);
-      qInfo() << "words.size():" << words.size();
-      if (words.size() < 1 || words.size() > max_words_in_rack) {
-        continue;
-      }
-      const QString alpha = Alphagram(Util::DecodeWord(rack));
-      std::vector<QString> answers;
-      for (const WordString& word : words) {
-        answers.push_back(Util::DecodeWord(word));
-      }
-      bool rack_has_repeat = false;
-      for (const QString word : answers) {
-        if (previous_answers.count(word) > 0) {
-          rack_has_repeat = true;
+  // Word Builder racks drawn before settling for the one that came closest
+  // to filling the grid.
+  constexpr int kMaxBuilderRacks = 1000;
+
+  // How far down the probability list a PROBABLE quiz reaches, per length.
+  constexpr int kProbableRanks = 1000;
+
+  // The (row, column) of each question whose answers take the given numbers
+  // of rows, filling each column top down and moving on when the next
+  // question doesn't fit. Questions that don't fit at all are left off, so
+  // the result may be shorter than num_answers.
+  std::vector<std::pair<size_t, size_t>> LayOutQuestions(
+      const std::vector<size_t>& num_answers, size_t num_rows,
+      size_t num_cols) {
+    std::vector<std::pair<size_t, size_t>> cells;
+    size_t i = 0;
+    for (size_t col = 0; col < num_cols; col++) {
+      for (size_t row = 0; row < num_rows && i < num_answers.size();) {
+        if (num_answers[i] + row > num_rows) {
+          break;
         }
+        cells.push_back({row, col});
+        row += num_answers[i];
+        i++;
       }
-      if (rack_has_repeat) continue;
-      for (const QString word : answers) {
-        previous_answers.insert(word);
+    }
+    return cells;
+  }
+}  // namespace
+
+void Wordmonger::DrawRacks(const QuizOptions& options, Random* random,
+                           int generation,
+                           std::vector<QuestionAndAnswer>* quiz) const {
+  if (blank_racks_.IsEmpty()) {
+    qInfo() << "drawing racks needs the blank rack table";
+    return;
+  }
+  const int min_solutions = std::max(1, options.min_solutions);
+  const int max_solutions =
+      std::min<int>({options.max_solutions,
+                     static_cast<int>(max_blank_words_per_rack),
+                     static_cast<int>(options.num_rows)});
+  const BlankRackPicker picker(alphagram_index_, blank_racks_);
+  const auto grid =
+      picker.Pick(options.lengths, min_solutions, max_solutions,
+                  options.num_rows, options.num_cols, random->Next());
+  if (IsStale(generation)) return;
+  const bool has_lexicons = gaddag_file_.HasLexicons();
+  for (const auto& column : grid) {
+    for (const BlankRackPicker::Question& question : column) {
+      std::vector<QString> answers;
+      std::vector<int> lexicons;
+      for (int word : question.words) {
+        answers.push_back(Util::DecodeWord(alphagram_index_.Word(word)));
+        if (has_lexicons) lexicons.push_back(alphagram_index_.Lexicons(word));
       }
-      QuestionAndAnswer q_and_a(alpha, answers);
-      questions_and_answers.push_back(q_and_a);
-      row += answers.size();
+      const QString alpha =
+          Alphagram(Util::DecodeWord(blank_racks_.Tiles(question.rack)));
+      quiz->emplace_back(alpha, answers, lexicons);
     }
   }
-  column_starts.push_back(questions_and_answers.size());
-  for (size_t i = 0; i < column_starts.size() - 1; i++) {
-    std::random_shuffle(questions_and_answers.begin() + column_starts[i],
-                        questions_and_answers.begin() + column_starts[i + 1]);
+}
+
+void Wordmonger::BuildWords(const QuizOptions& options, Random* random,
+                            int generation,
+                            std::vector<QuestionAndAnswer>* quiz) const {
+  if (anagrammer_ == nullptr) {
+    qInfo() << "building words needs a gaddag";
+    return;
+  }
+  const int min_length = options.min_length;
+  const int max_length = options.max_length;
+  const size_t num_rows = options.num_rows;
+  const size_t num_cols = options.num_cols;
+  const TileBag bag = TileBag::Scrabble();
+  // Each group of anagrams is one question, laid out the way AddQuestions
+  // does, shortest words first.
+  using Groups = std::map<std::pair<int, QString>,
+                          std::vector<std::pair<QString, int>>>;
+  Groups best_groups;
+  size_t best_num_words = 0;
+  const size_t grid_size = num_rows * num_cols;
+  // Reused across racks so that rejected racks cost no allocations.
+  std::vector<WordString> words;
+  std::vector<int> word_lexicons;
+  for (int i = 0; i < kMaxBuilderRacks; ++i) {
+    if (IsStale(generation)) return;
+    const WordString rack = bag.BlankRack(0, max_length, random);
+    // Stops as soon as the rack has more words than the grid holds.
+    const size_t num_words = anagrammer_->GetSubanagrams(
+        rack, min_length, max_length, &words, &word_lexicons, grid_size);
+    if (num_words <= best_num_words || num_words > grid_size) {
+      continue;
+    }
+    Groups groups;
+    for (size_t j = 0; j < num_words; ++j) {
+      const QString decoded = Util::DecodeWord(words[j]);
+      groups[{decoded.length(), Alphagram(decoded)}].push_back(
+          {decoded, word_lexicons[j]});
+    }
+    // Every group has to fit where AddQuestions will put it.
+    std::vector<size_t> num_answers;
+    for (const auto& group : groups) {
+      num_answers.push_back(group.second.size());
+    }
+    if (LayOutQuestions(num_answers, num_rows, num_cols).size() !=
+        groups.size()) {
+      continue;
+    }
+    best_groups = groups;
+    best_num_words = num_words;
+    // Good enough once at most one column is left empty.
+    if (best_num_words + num_rows > grid_size) break;
+  }
+  const bool has_lexicons = gaddag_file_.HasLexicons();
+  for (auto& group : best_groups) {
+    std::sort(group.second.begin(), group.second.end());
+    std::vector<QString> answers;
+    std::vector<int> lexicons;
+    for (const auto& word : group.second) {
+      answers.push_back(word.first);
+      if (has_lexicons) lexicons.push_back(word.second);
+    }
+    quiz->emplace_back(group.first.second, answers, lexicons);
   }
 }
 
@@ -169,8 +263,15 @@ void Wordmonger::CreateQuizChoiceWidgets() {
 
   num_solutions = new ChooserButtonRow(quiz_chooser, "Number of Solutions",
                                        LINE_EDITS);
-  num_solutions->AddLabelledLineEdit("MIN", 1, true);
-  num_solutions->AddLabelledLineEdit("MAX", 1, true);
+  num_solutions->AddLabelledLineEdit("MIN", 1, true,
+                                     &min_solutions_line_edit);
+  num_solutions->AddLabelledLineEdit("MAX", 1, true,
+                                     &max_solutions_line_edit);
+  for (QLineEdit* line_edit :
+       {min_solutions_line_edit, max_solutions_line_edit}) {
+    QObject::connect(line_edit, SIGNAL(textChanged(QString)), this,
+                     SLOT(OptionsChangedSlot(QString)));
+  }
   num_solutions->AddLineEditsStretch();
   quiz_chooser_layout->addWidget(num_solutions);
 
@@ -209,6 +310,11 @@ void Wordmonger::CreateQuizChoiceWidgets() {
 
   quiz_chooser_layout->setStretch(6, 1);
 
+  load_progress_bar = new QProgressBar(quiz_chooser);
+  load_progress_bar->setRange(0, kLoadSteps);
+  load_progress_bar->setFormat("Loading");
+  quiz_chooser_layout->addWidget(load_progress_bar);
+
   quiz_preview = new Preview(central_widget);
   choosers_layout->addWidget(quiz_preview, 0, 1, 1, 1);
 
@@ -235,6 +341,84 @@ int Wordmonger::RequestedCols() {
   return cols_line_edit->text().toInt();
 }
 
+int Wordmonger::RequestedMinSolutions() {
+  if (min_solutions_line_edit == nullptr) {
+    return 1;
+  }
+  return min_solutions_line_edit->text().toInt();
+}
+
+int Wordmonger::RequestedMaxSolutions() {
+  if (max_solutions_line_edit == nullptr) {
+    return 1;
+  }
+  return max_solutions_line_edit->text().toInt();
+}
+
+uint64_t Wordmonger::NextQuizSeed() {
+  const uint64_t seed = quiz_seed;
+  qInfo() << "quiz seed:" << seed;
+  quiz_seed = Random(seed).Next();
+  return seed;
+}
+
+QuizOptions Wordmonger::RequestedQuizOptions() {
+  QuizOptions options;
+  if (RequestedBuilderLengths(&options.min_length, &options.max_length)) {
+    options.kind = QuizOptions::BUILDER;
+  } else if (std::any_of(blanks->buttons_list.begin(),
+                         blanks->buttons_list.end(),
+                         [](const QuizPushButton* button) {
+                           return button->isChecked();
+                         })) {
+    options.kind = QuizOptions::BLANKS;
+    options.lengths = RequestedLengths(blanks);
+  } else {
+    options.kind = QuizOptions::WORDS;
+    options.lengths = RequestedLengths(word_length);
+  }
+  options.min_solutions = RequestedMinSolutions();
+  options.max_solutions = RequestedMaxSolutions();
+  options.ordering = RequestedOrdering();
+  options.num_rows = std::max(1, RequestedRows());
+  options.num_cols = std::max(1, RequestedCols());
+  return options;
+}
+
+QString Wordmonger::RequestedOrdering() {
+  for (const QuizPushButton* button : ordering->buttons_list) {
+    if (button->isChecked()) {
+      return button->objectName();
+    }
+  }
+  return "random";
+}
+
+std::vector<int> Wordmonger::RequestedLengths(const ChooserButtonRow* row) {
+  std::vector<int> lengths;
+  for (const QPushButton* button : row->buttons_list) {
+    if (button->isChecked()) {
+      lengths.push_back(button->text().toInt());
+    }
+  }
+  if (lengths.empty()) {
+    lengths.push_back(7);
+  }
+  return lengths;
+}
+
+bool Wordmonger::RequestedBuilderLengths(int* min_length, int* max_length) {
+  for (const QPushButton* button : word_builder->buttons_list) {
+    if (!button->isChecked()) continue;
+    const QStringList lengths = button->text().split('-');
+    if (lengths.size() != 2) continue;
+    *min_length = lengths[0].toInt();
+    *max_length = lengths[1].toInt();
+    return true;
+  }
+  return false;
+}
+
 void Wordmonger::CreateGridQuizWidgets() {
   choosing = false;
   questions_layout = new QGridLayout;
@@ -279,167 +463,115 @@ void Wordmonger::UnpauseTimer() {
 }
 
 void Wordmonger::LoadDictionaries() {
-  LoadDictionary("/Users/john/scrabble/csw.txt", &csw);
-  LoadDictionary("/Users/john/scrabble/twl.txt", &twl);
-
-  /*
-  GaddagMaker gaddag_maker(false, false);
-  gaddag_maker.MakeGaddag("/Users/johnolaughlin/scrabble/csw15.txt",
-                          "/Users/johnolaughlin/scrabble/csw15.gaddag");
-  */
-  LoadGaddag("/Users/johnolaughlin/scrabble/csw15.gaddag");
+  // The chooser is up before the lexicon is; Start waits for LoadFinishedSlot.
+  start_action->setEnabled(false);
+  connect(this, SIGNAL(LoadProgress(int, QString)), this,
+          SLOT(LoadProgressSlot(int, QString)));
+  connect(&load_watcher, SIGNAL(finished()), this, SLOT(LoadFinishedSlot()));
+  load_watcher.setFuture(QtConcurrent::run([this] {
+    const QString gaddag_path = "/Users/johnolaughlin/scrabble/csw15.gaddag";
+    emit LoadProgress(0, "Checking word lists");
+    // In Lexicon order.
+    LexiconSnapshot::Refresh({"/Users/johnolaughlin/scrabble/csw15.txt",
+                              "/Users/johnolaughlin/scrabble/twl.txt"},
+                             gaddag_path);
+    LoadGaddag(gaddag_path);
+  }));
   //TestGaddag();
 }
 
-std::set<WordString> Wordmonger::GetAnagrams(const WordString& rack,
-                                             bool must_use_all) {
-  int counts[LAST_LETTER + 1];
-  int used_counts[LAST_LETTER + 1];
-  for (int i = BLANK; i <= LAST_LETTER; ++i) {
-    counts[i] = 0;
-    used_counts[i] = 0;
-  }
-  uint32_t rack_bits = 0;
-  for (Letter letter : rack) {
-    counts[letter]++;
-    if (letter != BLANK) {
-      rack_bits |= 1 << letter;
-    }
-  }
-  //for (int i = BLANK; i <= LAST_LETTER; ++i) {
-  //  qInfo() << "i:" << i << "counts[i]:" << counts[i];
-  //}
-  std::vector<WordString> anagrams;
-  WordString prefix;
-
-  int unused_bits = ~0;
-  Anagram(gaddag_->Root(), used_counts, counts, unused_bits, rack_bits, &prefix,
-          &anagrams, must_use_all);
-  std::set<WordString> unique_words(anagrams.begin(), anagrams.end());
-  //for (const WordString& word : unique_words) {
-  // qInfo() << "word:" << Util::DecodeWord(word);
-  //}
-  //qInfo() << "found" << unique_words.size() << "unique words";
-  return unique_words;
-}
-
 void Wordmonger::TestGaddag() {
   QString polish_blank = "POLISH??";
   WordString rack = Util::EncodeWord(polish_blank);
-  std::set<WordString> unique_words = GetAnagrams(rack, true);
-  for (const WordString& word : unique_words) {
+  const std::vector<WordString> words = anagrammer_->GetAnagrams(rack, true);
+  for (const WordString& word : words) {
     qInfo() << "word:" << Util::DecodeWord(word);
   }
-  qInfo() << "found" << unique_words.size() << "unique words";
+  qInfo() << "found" << words.size() << "words";
 }
 
-void Wordmonger::Anagram(const unsigned char* node, int* used_counts,
-                         int* counts, uint32_t unused_bits,
-                         uint32_t rack_bits, WordString* prefix,
-                         std::vector<WordString>* anagrams,
-                         bool must_use_all) {
-//  qInfo() << "Anagram(...) prefix:" << Util::DecodeWord(*prefix)
-//          << "unused_bits:" << Util::DecodeBits(unused_bits)
-//          << "rack_bits:" << Util::DecodeBits(rack_bits)
-//          << "used_counts:" << Util::DecodeCounts(used_counts)
-//          << "counts: " << Util::DecodeCounts(counts);
-  if (prefix->length() == 1) {
-    node = gaddag_->FollowIndex(gaddag_->ChangeDirection(node));
+// Runs the same racks through each file so that compressed and uncompressed
+// layouts can be compared. Every page is faulted in first, so the times show
+// the cost of decoding against the CPU cache misses saved by a smaller file.
+void Wordmonger::BenchmarkGaddags(const std::vector<QString>& paths) {
+  const int num_racks = 20000;
+  Random random(1);
+  const TileBag bag = TileBag::Scrabble();
+  std::vector<WordString> racks;
+  for (int i = 0; i < num_racks; ++i) {
+    racks.push_back((i % 2 == 0) ? bag.RandomRack(8, &random)
+                                 : bag.BlankRack(1, 7, &random));
   }
-  if (counts[BLANK] > 0 || gaddag_->HasAnyChild(node, rack_bits)) {
-    Letter min_letter = FIRST_LETTER;
-    int child_index = 0;
-    for (;;) {
-      Letter found_letter;
-      const unsigned char* child = nullptr;
-      if (counts[BLANK] > 0) {
-        child =
-            gaddag_->NextRackChild(node, min_letter, unused_bits,
-                                   &child_index, &found_letter);
-        if (child == nullptr) {
-          //qInfo() << "no child with letter past" << Util::DecodeLetter(min_letter);
-          return;
-        }
-        assert(found_letter >= FIRST_LETTER);
-        assert(found_letter <= LAST_LETTER);
-        //qInfo() << "blank found_letter" << Util::DecodeLetter(found_letter);
-        prefix->push_back(found_letter);
-        counts[BLANK]--;
-        if (gaddag_->CompletesWord(child)) {
-          if (!must_use_all || (rack_bits == 0 && counts[BLANK] == 0)) {
-            anagrams->push_back(*prefix);
-          }
-        }
-        const unsigned char* new_node = gaddag_->FollowIndex(child);
-        if (new_node != nullptr) {
-          Anagram(new_node, used_counts, counts, unused_bits, rack_bits,
-                  prefix, anagrams, must_use_all);
-        } else {
-          //qInfo() << "no new node for blank letter";
-        }
-        prefix->pop_back();
-        counts[BLANK]++;
-      } else {
-        child = gaddag_->NextRackChild(node, min_letter, rack_bits,
-                                       &child_index, &found_letter);
-        if (child == nullptr) return;
+  for (const QString& path : paths) {
+    GaddagFile file;
+    if (!file.Open(path, GaddagFile::POPULATE)) continue;
+    Anagrammer* anagrammer = Anagrammer::Create(file);
+    if (anagrammer == nullptr) continue;
+    // The first pass warms the caches.
+    for (int pass = 0; pass < 2; ++pass) {
+      QElapsedTimer timer;
+      timer.start();
+      size_t num_words = 0;
+      std::vector<WordString> anagrams;
+      for (const WordString& rack : racks) {
+        num_words += anagrammer->GetAnagrams(rack, true, &anagrams);
       }
-      if (counts[found_letter] > 0) {
-        prefix->push_back(found_letter);
-        counts[found_letter]--;
-        used_counts[found_letter]++;
-        const uint32_t found_letter_mask = 1 << found_letter;
-        if (counts[found_letter] == 0) {
-          rack_bits &= ~found_letter_mask;
-          unused_bits &= ~found_letter_mask;
-        }
-        if (gaddag_->CompletesWord(child)) {
-          if (!must_use_all || (rack_bits == 0 && counts[BLANK] == 0)) {
-            anagrams->push_back(*prefix);
-          }
-        }
-        const unsigned char* new_node = gaddag_->FollowIndex(child);
-        if (new_node != nullptr) {
-          Anagram(new_node, used_counts, counts, unused_bits, rack_bits,
-                  prefix, anagrams, must_use_all);
-        }
-        prefix->pop_back();
-        counts[found_letter]++;
-        used_counts[found_letter]--;
-        unused_bits |= found_letter_mask;
-        rack_bits |= found_letter_mask;
-      }
-      min_letter = found_letter + 1;
-      ++child_index;
+      qInfo() << path << (file.IsCompressed() ? "compressed" : "")
+              << file.NodeDataSize() << "bytes, pass" << pass << ":"
+              << timer.nsecsElapsed() / num_racks << "ns per rack,"
+              << num_words << "words";
     }
+    delete anagrammer;
   }
 }
 
 void Wordmonger::LoadGaddag(const QString& path) {
-  QFile input(path);
-  char version_byte;
-  if (input.open(QIODevice::ReadOnly)) {
-    input.getChar(&version_byte);
-    qInfo() << "version_byte:" << static_cast<int>(version_byte);
-    char hash[16];
-    input.read(hash, sizeof(hash));
-    const int root_pos = input.pos();
-
-    char last_letter;
-    input.getChar(&last_letter);
-    char bitset_size;
-    input.getChar(&bitset_size);
-    char index_size;
-    input.getChar(&index_size);
-
-    qInfo() << "root_pos:" << root_pos;
-    const int size = input.size() - root_pos;
-    qInfo() << "gaddag size:" << size;
-    gaddag_bytes_ = new char[size];
-    input.read(gaddag_bytes_, size);
-    gaddag_ = new Gaddag(gaddag_bytes_, last_letter, bitset_size, index_size);
+  emit LoadProgress(0, "Opening " + QFileInfo(path).fileName());
+  if (!gaddag_file_.Open(path, GaddagFile::WILL_NEED)) {
+    qInfo() << "could not load gaddag from" << path;
+    return;
   }
-  input.close();
+  qInfo() << "version:" << gaddag_file_.Version();
+  qInfo() << (gaddag_file_.IsDawg() ? "dawg size:" : "gaddag size:")
+          << gaddag_file_.NodeDataSize();
+  anagrammer_ = Anagrammer::Create(gaddag_file_);
+  if (anagrammer_ == nullptr) return;
+  emit LoadProgress(1, "Indexing alphagrams");
+  if (!alphagram_index_.Build(*anagrammer_)) return;
+
+  // These only read the index, so they're built side by side.
+  emit LoadProgress(2, "Ranking racks");
+  QFuture<void> ranking = QtConcurrent::run([this] {
+    probability_index_.Build(alphagram_index_, Util::ScrabbleBag());
+  });
+  // Built from the index the first time a lexicon is loaded, then read back
+  // until the gaddag changes.
+  const QString blanks_path = BlankRackTable::PathFor(path);
+  if (!blank_racks_.Read(blanks_path, gaddag_file_.Hash())) {
+    blank_racks_.Build(alphagram_index_, Util::ScrabbleBag(),
+                       gaddag_file_.Hash());
+    blank_racks_.Write(blanks_path);
+  }
+  ranking.waitForFinished();
+  emit LoadProgress(kLoadSteps, "Ready");
+}
+
+void Wordmonger::LoadProgressSlot(int step, QString what) {
+  load_progress_bar->setValue(step);
+  load_progress_bar->setFormat(what);
+}
+
+void Wordmonger::LoadFinishedSlot() {
+  lexicon_loaded = true;
+  // Word Builder only needs the anagrammer; the other quizzes check for
+  // their indexes themselves.
+  if (anagrammer_ == nullptr) {
+    load_progress_bar->setFormat("Could not load the lexicon");
+    return;
+  }
+  load_progress_bar->hide();
+  start_action->setEnabled(true);
+  PrefetchQuiz();
 }
 
 void Wordmonger::timerEvent(QTimerEvent *event) {
@@ -530,24 +662,23 @@ QString QuestionAndAnswer::GetClue() const {
 }
 
 void Wordmonger::AddQuestions() {
- int i = 0;
- for (size_t col = 0; col < num_cols; col++) {
-   for (size_t row = 0; row < num_rows;) {
-     const std::vector<QString>& answers =
-         questions_and_answers[i].GetAnswers();
-     if (answers.size() + row > num_rows) {
-       break;
-     }
-     Question* question = new Question(this, i);
-     questions.push_back(question);
-     questions_layout->addWidget(question, row, col, answers.size(), 1);
-     for (const QString& answer : answers) {
-       //qInfo() << "answer: " << answer << " i: " << i;
-       answer_map[answer].push_back(question);
-     }
-     row += answers.size();
-     i++;
-   }
+  std::vector<size_t> num_answers;
+  for (const QuestionAndAnswer& q_and_a : questions_and_answers) {
+    num_answers.push_back(q_and_a.GetAnswers().size());
+  }
+  const std::vector<std::pair<size_t, size_t>> cells =
+      LayOutQuestions(num_answers, num_rows, num_cols);
+  for (size_t i = 0; i < cells.size(); ++i) {
+    const std::vector<QString>& answers =
+        questions_and_answers[i].GetAnswers();
+    Question* question = new Question(this, i);
+    questions.push_back(question);
+    questions_layout->addWidget(question, cells[i].first, cells[i].second,
+                                answers.size(), 1);
+    for (const QString& answer : answers) {
+      //qInfo() << "answer: " << answer << " i: " << i;
+      answer_map[answer].push_back(question);
+    }
   }
 }
 
@@ -624,6 +755,7 @@ ChooserButtonRow::ChooserButtonRow(QWidget *parent,
 void ChooserButtonRow::AddButton(const QString& label, const QString& id) {
   buttons_list << new QuizPushButton(this, buttons);
   buttons_list.back()->setText(label);
+  buttons_list.back()->setObjectName(id);
   buttons_list.back()->setCheckable(true);
   buttons_list.back()->setStyleSheet(R"(
     QPushButton {
@@ -956,7 +1088,7 @@ void Question::paintEvent(QPaintEvent* event) {
 
       painter.setFont({Wordmonger::get()->FontName(), answer_font_size,
                        Wordmonger::get()->FontWeight()});
-      if (Wordmonger::get()->IsTwl(answer)) {
+      if (q_and_a.InLexicon(i, TWL_LEXICON)) {
         painter.setPen({0, 0, 0, solved_this_answer ? 224 : 255});
       } else {
         painter.setPen({200, 0, 0, solved_this_answer ? 224 : 255});
@@ -979,31 +1111,142 @@ void Question::paintEvent(QPaintEvent* event) {
   painter.end();
 }
 
-void Wordmonger::ChooseWords() {
-  std::map<QString, std::vector<QString>> sets;
-  for (const QString& word : csw) {
-    if (word.length() != 7) {
-      continue;
-    }
-    const QString alpha = Alphagram(word);
-    sets[alpha].push_back(word);
+void Wordmonger::ChooseWords(const QuizOptions& options, Random* random,
+                             int generation,
+                             std::vector<QuestionAndAnswer>* quiz) const {
+  if (alphagram_index_.IsEmpty()) {
+    qInfo() << "choosing words needs the alphagram index";
+    return;
   }
-
-  std::vector<std::pair<QString, std::vector<QString>>> pairs(
-        sets.begin(), sets.end());
-  std::random_shuffle(pairs.begin(), pairs.end());
-  size_t i = 0;
-  for (const auto& pair : pairs) {
-    if (pair.second.size() != 1) {
-      continue;
+  const std::vector<int>& lengths = options.lengths;
+  const int min_solutions = options.min_solutions;
+  // An alphagram with more answers than rows fits in no column.
+  const int max_solutions =
+      std::min<int>(options.max_solutions, options.num_rows);
+  const int grid_size = options.num_rows * options.num_cols;
+  std::vector<int> alphagrams;
+  if (options.ordering == "probability" && !probability_index_.IsEmpty()) {
+    // Drawn from the most probable alphagrams and asked in rank order.
+    std::vector<int> ranked;
+    for (int length : lengths) {
+      probability_index_.Ranked(length, 1, kProbableRanks, &ranked);
     }
-    if (i >= num_cols * num_rows) {
-      return;
+    std::vector<int> matching;
+    for (int alphagram : ranked) {
+      const int num_words = alphagram_index_.At(alphagram).num_words;
+      if (num_words >= min_solutions && num_words <= max_solutions) {
+        matching.push_back(alphagram);
+      }
+    }
+    std::vector<int> picks;
+    Util::SampleRanges({{0, static_cast<int>(matching.size())}}, grid_size,
+                       random, &picks);
+    std::sort(picks.begin(), picks.end());
+    for (int pick : picks) {
+      alphagrams.push_back(matching[pick]);
     }
-    i++;
-    QuestionAndAnswer q_and_a(pair.first, pair.second);
-    questions_and_answers.push_back(q_and_a);
+    std::stable_sort(alphagrams.begin(), alphagrams.end(),
+                     [this](int a, int b) {
+                       return probability_index_.Rank(a) <
+                              probability_index_.Rank(b);
+                     });
+  } else {
+    alphagram_index_.Sample(lengths, min_solutions, max_solutions, grid_size,
+                            random, &alphagrams);
+  }
+  if (IsStale(generation)) return;
+  const bool has_lexicons = gaddag_file_.HasLexicons();
+  for (int alphagram : alphagrams) {
+    const AlphagramIndex::Alphagram& entry = alphagram_index_.At(alphagram);
+    std::vector<QString> answers;
+    std::vector<int> lexicons;
+    for (int i = entry.first_word; i < entry.first_word + entry.num_words;
+         ++i) {
+      answers.push_back(Util::DecodeWord(alphagram_index_.Word(i)));
+      if (has_lexicons) lexicons.push_back(alphagram_index_.Lexicons(i));
+    }
+    quiz->emplace_back(Alphagram(answers[0]), answers, lexicons);
+  }
+}
+
+std::vector<QuestionAndAnswer> Wordmonger::MakeQuiz(const QuizOptions& options,
+                                                    uint64_t seed,
+                                                    int generation) const {
+  Random random(seed);
+  std::vector<QuestionAndAnswer> quiz;
+  switch (options.kind) {
+    case QuizOptions::WORDS:
+      ChooseWords(options, &random, generation, &quiz);
+      break;
+    case QuizOptions::BLANKS:
+      DrawRacks(options, &random, generation, &quiz);
+      break;
+    case QuizOptions::BUILDER:
+      BuildWords(options, &random, generation, &quiz);
+      break;
+  }
+  return quiz;
+}
+
+void Wordmonger::PrefetchQuiz() {
+  // Until then the indexes belong to the loading thread.
+  if (!lexicon_loaded || anagrammer_ == nullptr) return;
+  const QuizOptions options = RequestedQuizOptions();
+  if (has_next_quiz && next_quiz_options == options) return;
+  // A quiz for stale options stops at its next check and is dropped. Its
+  // seed goes to the replacement, so only played quizzes use seeds up.
+  const uint64_t seed = has_next_quiz ? next_quiz_seed : NextQuizSeed();
+  const int generation = ++quiz_generation;
+  next_quiz_options = options;
+  next_quiz_seed = seed;
+  has_next_quiz = true;
+  next_quiz = QtConcurrent::run([this, options, seed, generation] {
+    return MakeQuiz(options, seed, generation);
+  });
+}
+
+std::vector<QuestionAndAnswer> Wordmonger::TakeQuiz(
+    const QuizOptions& options) {
+  if (has_next_quiz && next_quiz_options == options) {
+    has_next_quiz = false;
+    // Usually ready; otherwise this waits only for what's left of it.
+    return next_quiz.result();
   }
+  const uint64_t seed = has_next_quiz ? next_quiz_seed : NextQuizSeed();
+  has_next_quiz = false;
+  const int generation = ++quiz_generation;
+  return MakeQuiz(options, seed, generation);
+}
+
+void Wordmonger::StartQuizSlot() {
+  if (!lexicon_loaded) return;
+  const QuizOptions options = RequestedQuizOptions();
+  std::vector<QuestionAndAnswer> quiz = TakeQuiz(options);
+  if (quiz.empty()) {
+    qInfo() << "no questions for these options";
+    PrefetchQuiz();
+    return;
+  }
+  if (choosing) {
+    quiz_chooser->hide();
+    quiz_preview->hide();
+    detail_chooser->hide();
+    CreateGridQuizWidgets();
+  }
+  for (Question* question : questions) {
+    questions_layout->removeWidget(question);
+    question->hide();
+    question->deleteLater();
+  }
+  questions.clear();
+  answer_map.clear();
+  num_rows = options.num_rows;
+  num_cols = options.num_cols;
+  questions_and_answers.swap(quiz);
+  AddQuestions();
+  StartTimer();
+  // The next round generates while this one is played.
+  PrefetchQuiz();
 }
 
 void Wordmonger::LoadSingleAnagramWords() {
@@ -1014,7 +1257,11 @@ void Wordmonger::LoadSingleAnagramWords() {
     while (!in.atEnd() && i < 45) {
       QString word = in.readLine();
       //qInfo() << "word: " << word;
-      QuestionAndAnswer q_and_a(word, {word});
+      std::vector<int> lexicons;
+      if (anagrammer_ != nullptr && gaddag_file_.HasLexicons()) {
+        lexicons.push_back(anagrammer_->Lexicons(Util::EncodeWord(word)));
+      }
+      QuestionAndAnswer q_and_a(word, {word}, lexicons);
       questions_and_answers.push_back(q_and_a);
       ++i;
     }
@@ -1023,21 +1270,10 @@ void Wordmonger::LoadSingleAnagramWords() {
   qInfo() << "#words: " << i;
 }
 
-void Wordmonger::LoadDictionary(const QString& path, std::set<QString>* dict) {
-  QFile input(path);
-  if (input.open(QIODevice::ReadOnly)) {
-    QTextStream in(&input);
-    while (!in.atEnd()) {
-      QString word = in.readLine();
-      dict->insert(word);
-    }
-    input.close();
-  }
-  qInfo() << "loaded " << dict->size() << " from " << path;
-}
-
 QuestionAndAnswer::QuestionAndAnswer(const QString& clue,
-                                     const std::vector<QString>& answers) {
+                                     const std::vector<QString>& answers,
+                                     const std::vector<int>& lexicons) {
   this->clue = clue;
   this->answers = answers;
+  this->lexicons = lexicons;
 }
@@ -6,18 +6,29 @@
 #include <QLabel>
 #include <QTimer>
 #include <QElapsedTimer>
+#include <QFuture>
+#include <QFutureWatcher>
 #include <QGridLayout>
+#include <QProgressBar>
 #include <QPushButton>
 #include <QMainWindow>
 #include <QObject>
 #include <QLineEdit>
 #include <QWidget>
 
+#include <atomic>
 #include <set>
+#include <tuple>
 #include <vector>
 
+#include "alphagram_index.h"
+#include "anagrammer.h"
+#include "blank_rack_table.h"
 #include "fixed_string.h"
-#include "gaddag.h"
+#include "gaddag_file.h"
+#include "probability_index.h"
+#include "random.h"
+#include "tile_bag.h"
 
 class QLineEdit;
 class QuizPushButton;
@@ -34,6 +45,10 @@ enum ChooserType { BUTTONS, LINE_EDITS };
 
 enum ButtonType { MULTIPLE_IN_ROW, ONE_IN_ROW };
 
+// Bits in the lexicon masks stored in the gaddag, in the order its word lists
+// were passed to GaddagMaker.
+enum Lexicon { CSW_LEXICON, TWL_LEXICON };
+
 class ChooserButtonRow : public QWidget {
  public:
   ChooserButtonRow(QWidget* parent = 0,
@@ -136,15 +151,51 @@ class QuizPushButton : public QPushButton {
 
 class QuestionAndAnswer {
  public:
-  QuestionAndAnswer(const QString& clue, const std::vector<QString>& answers);
+  // lexicons holds a Lexicon bitmask for each answer; if it's empty every
+  // answer is taken to be in every lexicon.
+  QuestionAndAnswer(const QString& clue, const std::vector<QString>& answers,
+                    const std::vector<int>& lexicons = std::vector<int>());
   QString GetClue() const;
   const std::vector<QString>& GetAnswers() const {
     return answers;
   }
+  bool InLexicon(int i, Lexicon lexicon) const {
+    return lexicons.empty() || (lexicons[i] & (1 << lexicon)) != 0;
+  }
 
  private:
   QString clue;
   std::vector<QString> answers;
+  std::vector<int> lexicons;
+};
+
+// Everything on the quiz chooser that decides which questions a quiz gets,
+// read once on the GUI thread so the quiz can be generated on another.
+struct QuizOptions {
+  enum Kind { WORDS, BLANKS, BUILDER };
+
+  Kind kind = WORDS;
+  // Word lengths, or rack lengths for BLANKS.
+  std::vector<int> lengths;
+  // Word lengths for BUILDER.
+  int min_length = 0;
+  int max_length = 0;
+  int min_solutions = 1;
+  int max_solutions = 1;
+  // The id of the checked Ordering button.
+  QString ordering;
+  size_t num_rows = 0;
+  size_t num_cols = 0;
+
+  bool operator==(const QuizOptions& other) const {
+    return std::tie(kind, lengths, min_length, max_length, min_solutions,
+                    max_solutions, ordering, num_rows, num_cols) ==
+           std::tie(other.kind, other.lengths, other.min_length,
+                    other.max_length, other.min_solutions,
+                    other.max_solutions, other.ordering, other.num_rows,
+                    other.num_cols);
+  }
+  bool operator!=(const QuizOptions& other) const { return !(*this == other); }
 };
 
 class Wordmonger : public QMainWindow {
@@ -159,18 +210,30 @@ class Wordmonger : public QMainWindow {
   }
   void CheckIfQuizFinished();
   bool QuizFinished() const { return quiz_finished; }
-  bool IsTwl(QString word) const {
-    return twl.count(word) > 0;
-  }
   QString FontName() const { return font_name; }
   QFont::Weight FontWeight() const { return font_weight; }
   QVBoxLayout* QuizChooserLayout() {return quiz_chooser_layout; }
 
+  // Times the same racks in each gaddag file; run with --benchmark.
+  static void BenchmarkGaddags(const std::vector<QString>& paths);
+
   ~Wordmonger();
 
  public slots:
   void TogglePauseSlot() { paused ? UnpauseTimer() : PauseTimer(); }
 
+  // Shows the prefetched quiz if it was made for the current options, and
+  // starts making the next one.
+  void StartQuizSlot();
+
+  void LoadProgressSlot(int step, QString what);
+  // Enables Start once the lexicon is usable.
+  void LoadFinishedSlot();
+
+  void OptionsChangedSlot(QString text) {
+    if (!text.isEmpty()) PrefetchQuiz();
+  }
+
   void ToggleFullscreenSlot() {
     isMaximized() ? showNormal() : showMaximized();
   }
@@ -207,6 +270,7 @@ class Wordmonger : public QMainWindow {
         !cols_line_edit->text().isEmpty()) {
       num_words_line_edit->setText(QString::number(
                                      RequestedRows() * RequestedCols()));
+      PrefetchQuiz();
     }
   }
 
@@ -216,6 +280,7 @@ class Wordmonger : public QMainWindow {
         !rows_line_edit->text().isEmpty()) {
       num_words_line_edit->setText(QString::number(
                                      RequestedRows() * RequestedCols()));
+      PrefetchQuiz();
     }
   }
 
@@ -224,6 +289,7 @@ class Wordmonger : public QMainWindow {
     qInfo() << "sender: " << sender_button->text();
     if (!sender_button->isChecked()) {
       qInfo() << "sender is not checked";
+      PrefetchQuiz();
       return;
     }
     const ChooserButtonRow* parent_row =
@@ -249,8 +315,13 @@ class Wordmonger : public QMainWindow {
         button->setChecked(false);
       }
     }
+    PrefetchQuiz();
   }
 
+ signals:
+  // From the loading thread; step runs from 0 to kLoadSteps.
+  void LoadProgress(int step, QString what);
+
    protected:
     void resizeEvent(QResizeEvent * event) override;
     void timerEvent(QTimerEvent * event) override;
@@ -259,8 +330,27 @@ class Wordmonger : public QMainWindow {
     void CreateCentralWidgetAndLayout();
     void CreateQuizChoiceWidgets();
     void CreateGridQuizWidgets();
-    void ChooseWords();
-    void DrawRacks();
+    // The generators append a quiz for options to quiz. They only read the
+    // lexicon's indexes, so they can run on any thread. Once generation is
+    // no longer quiz_generation nobody wants the quiz, and they stop early.
+    void ChooseWords(const QuizOptions& options, Random* random,
+                     int generation,
+                     std::vector<QuestionAndAnswer>* quiz) const;
+    void DrawRacks(const QuizOptions& options, Random* random, int generation,
+                   std::vector<QuestionAndAnswer>* quiz) const;
+    void BuildWords(const QuizOptions& options, Random* random, int generation,
+                    std::vector<QuestionAndAnswer>* quiz) const;
+    bool IsStale(int generation) const {
+      return generation != quiz_generation.load(std::memory_order_relaxed);
+    }
+    std::vector<QuestionAndAnswer> MakeQuiz(const QuizOptions& options,
+                                            uint64_t seed,
+                                            int generation) const;
+    // Starts making a quiz for the current options in the background,
+    // unless one is already on its way. One for stale options is cancelled.
+    void PrefetchQuiz();
+    // The prefetched quiz if it was made for options, otherwise a new one.
+    std::vector<QuestionAndAnswer> TakeQuiz(const QuizOptions& options);
     void StartTimer();
     void PauseTimer();
     void UnpauseTimer();
@@ -269,6 +359,17 @@ class Wordmonger : public QMainWindow {
     void AddQuestions();
     int RequestedRows();
     int RequestedCols();
+    int RequestedMinSolutions();
+    int RequestedMaxSolutions();
+    std::vector<int> RequestedLengths(const ChooserButtonRow* row);
+    // A generator for the next quiz, seeded from quiz_seed, which then moves
+    // on. quiz_seed starts from WORDMONGER_SEED if it is set, so launching
+    // with a logged seed and choosing the same options regenerates that quiz.
+    uint64_t NextQuizSeed();
+    QuizOptions RequestedQuizOptions();
+    // The id of the checked Ordering button.
+    QString RequestedOrdering();
+    bool RequestedBuilderLengths(int* min_length, int* max_length);
 
     QWidget* central_widget;
     QVBoxLayout* central_layout;
@@ -292,24 +393,36 @@ class Wordmonger : public QMainWindow {
     std::map<QString, std::vector<Question*>> answer_map;
 
     QMenuBar* menu_bar;
+    QAction* start_action;
     QAction* pause_action;
     QAction* fullscreen_action;
     QMenu* quiz_menu;
     void CreateMenus();
 
+    static constexpr int kLoadSteps = 3;
+    // Loads on a worker thread, reporting LoadProgress; see LoadFinishedSlot.
     void LoadDictionaries();
-    void LoadDictionary(const QString& path, std::set<QString>* dict);
     void LoadGaddag(const QString& path);
     void TestGaddag();
-    std::set<WordString> GetAnagrams(const WordString& rack, bool must_use_all);
-    void Anagram(const unsigned char* node, int* used_counts, int* counts,
-                 uint32_t used_bits, uint32_t rack_bits, WordString* prefix,
-                 std::vector<WordString>* anagrams, bool must_use_all);
 
-    std::set<QString> twl;
-    std::set<QString> csw;
-    char* gaddag_bytes_;
-    Gaddag* gaddag_;
+    GaddagFile gaddag_file_;
+    Anagrammer* anagrammer_ = nullptr;
+    AlphagramIndex alphagram_index_;
+    BlankRackTable blank_racks_;
+    ProbabilityIndex probability_index_;
+
+    QFutureWatcher<void> load_watcher;
+    QProgressBar* load_progress_bar = nullptr;
+    // Set on the GUI thread once loading has finished, whether or not it
+    // worked. Until then nothing else may touch the lexicon members.
+    bool lexicon_loaded = false;
+
+    QFuture<std::vector<QuestionAndAnswer>> next_quiz;
+    QuizOptions next_quiz_options;
+    uint64_t next_quiz_seed = 0;
+    bool has_next_quiz = false;
+    // Bumped whenever the quiz being made is no longer wanted.
+    std::atomic<int> quiz_generation{0};
 
     QLineEdit* answer_line_edit = nullptr;
 
@@ -317,6 +430,9 @@ class Wordmonger : public QMainWindow {
     QLineEdit* cols_line_edit = nullptr;
     QLineEdit* num_words_line_edit = nullptr;
 
+    QLineEdit* min_solutions_line_edit = nullptr;
+    QLineEdit* max_solutions_line_edit = nullptr;
+
     QLineEdit* per_set_line_edit = nullptr;
     QLineEdit* per_word_line_edit = nullptr;
     QLineEdit* per_quiz_line_edit = nullptr;
@@ -328,6 +444,7 @@ class Wordmonger : public QMainWindow {
     size_t num_rows;
     size_t num_cols;
     size_t max_blank_words_per_rack;
+    uint64_t quiz_seed;
     QString font_name;
     QFont::Weight font_weight;
 
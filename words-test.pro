@@ -6,7 +6,7 @@
 
 QT       += core gui
 
-greaterThan(QT_MAJOR_VERSION, 4): QT += widgets
+greaterThan(QT_MAJOR_VERSION, 4): QT += widgets concurrent
 
 TARGET = Wordmonger
 TEMPLATE = app
@@ -24,15 +24,36 @@ DEFINES += QT_DEPRECATED_WARNINGS
 
 
 SOURCES += main.cpp wordmonger.cpp \
+    alphagram_index.cpp \
+    anagrammer.cpp \
+    blank_rack_picker.cpp \
+    blank_rack_table.cpp \
     gaddag_maker.cpp \
     gaddag.cpp \
-    util.cpp
+    gaddag_file.cpp \
+    lexicon_snapshot.cpp \
+    probability_index.cpp \
+    tile_bag.cpp \
+    util.cpp \
+    word_numbering.cpp
 
 HEADERS += wordmonger.h \
+    alphagram_index.h \
+    anagrammer.h \
+    blank_rack_picker.h \
+    blank_rack_table.h \
+    compressed_gaddag.h \
     gaddag_maker.h \
     fixed_string.h \
     gaddag.h \
+    gaddag_file.h \
+    lexicon_snapshot.h \
     util.h \
-    long_fixed_string.h
+    long_fixed_string.h \
+    packed_rack.h \
+    probability_index.h \
+    random.h \
+    tile_bag.h \
+    word_numbering.h
 
 FORMS +=